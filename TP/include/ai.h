@@ -3,25 +3,98 @@
 
 #include "common.h"
 
+#define AI_TIME_ENV "CHOMP_TIME_MS"    // think budget per move of the timed strategies, in milliseconds
+#define AI_DEFAULT_TIME_MS 20
+
+/**
+ * Move selection strategy, same contract as choose_best_move()
+ */
+typedef int (*ai_strategy_t)(int *move, const game_state_t *gs, sync_t *sync, int id);
+
 /**
- * Chooses the best move for a player using primitive AI logic
+ * Allocates the calling thread's evaluation workspace for a width x height board,
+ * so the first move pays no allocation. Optional: choose_best_move() builds it on
+ * first use, and rebuilds it if the board size changes.
+ * @param width: board width
+ * @param height: board height
+ * @return: 0 on success, -1 on allocation failure
+ */
+int ai_init(unsigned short width, unsigned short height);
+
+/**
+ * Chooses the best move for a player by Voronoi territory: one multi-source BFS,
+ * from every candidate cell and every opponent head at once, splits the free
+ * cells by nearest player and credits each of ours to the candidates closest to
+ * it; the move keeping the largest, most valuable share wins. With no opponent
+ * in the components around us, the component sizes kept across turns replace it.
  * @param move: output array [2] to store the chosen direction vector
  * @param gs: pointer to the game state
- * @param sync: pointer to synchronization structures  
+ * @param sync: pointer to synchronization structures, or NULL if gs is a private snapshot
  * @param id: player ID
  * @return: 0 if a valid move is found, -1 if no moves available
  */
 int choose_best_move(int *move, const game_state_t *gs, sync_t *sync, int id);
 
+/**
+ * Chooses the best move for a player from a bounded flood fill around each
+ * candidate cell, penalizing cells close to an opponent
+ * @param move: output array [2] to store the chosen direction vector
+ * @param gs: pointer to the game state
+ * @param sync: pointer to synchronization structures, or NULL if gs is a private snapshot
+ * @param id: player ID
+ * @return: 0 if a valid move is found, -1 if no moves available
+ */
+int choose_best_move_flood(int *move, const game_state_t *gs, sync_t *sync, int id);
+
 /**
  * Chooses the best move for a player using naive/primitive AI logic
  * Simple algorithm that selects the first valid move found in directional order
  * @param move: output array [2] to store the chosen direction vector
  * @param gs: pointer to the game state
- * @param sync: pointer to synchronization structures  
+ * @param sync: pointer to synchronization structures, or NULL if gs is a private snapshot
  * @param id: player ID
  * @return: 0 if a valid move is found, -1 if no moves available
  */
 int choose_best_move_naive(int *move, const game_state_t *gs, sync_t *sync, int id);
 
+/**
+ * Voronoi split of the free cells between player id (from its head) and the
+ * opponents in rivals: cells reached strictly first by each player, and their value
+ * @param gs: pointer to the game state (the caller holds whatever lock it needs)
+ * @param id: player ID
+ * @param rivals: bitmask of opponents taking part
+ * @param radius: only cells within this many moves of a head count (0: the whole board)
+ * @param cells: output array [MAX_PLAYERS] of region sizes
+ * @param value: output array [MAX_PLAYERS] of region values
+ * @return: 0 on success, -1 if the workspace could not be allocated
+ */
+int evaluate_territory(const game_state_t *gs, int id, unsigned int rivals, int radius, int *cells, int *value);
+
+/**
+ * Closest opponent that can still move, by Chebyshev distance between heads
+ * @param gs: pointer to the game state
+ * @param id: player ID
+ * @return: opponent ID, or -1 if every opponent is blocked
+ */
+int ai_nearest_opponent(const game_state_t *gs, int id);
+
+/**
+ * Think budget per move of the timed strategies (search, MCTS)
+ * @return: AI_TIME_ENV milliseconds if set and positive, AI_DEFAULT_TIME_MS otherwise
+ */
+long long ai_time_budget_ms(void);
+
+/**
+ * Plans a path of up to max_moves consecutive moves (e.g. a run along a corridor)
+ * by applying strategy repeatedly on a private copy of the state.
+ * The copy is modified: the player's head, score, valid moves and claimed cells advance.
+ * @param dirs: output array of at least max_moves direction codes (0-7)
+ * @param max_moves: maximum plan length (the player's credit window)
+ * @param gs: private, writable game state snapshot (never the shared mapping)
+ * @param id: player ID
+ * @param strategy: move selection (e.g. choose_best_move)
+ * @return: number of moves planned (0 if no move is available)
+ */
+int plan_moves(unsigned char *dirs, int max_moves, game_state_t *gs, int id, ai_strategy_t strategy);
+
 #endif //AI_H
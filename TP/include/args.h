@@ -2,6 +2,14 @@
 #define ARGS_H
 
 #include "common.h"
+#include "event.h"
+
+#define MAX_INSTANCES 64
+
+typedef enum {
+    TRANSPORT_PIPE = 0,
+    TRANSPORT_RING
+} move_transport_t;
 
 typedef struct {
     unsigned short width;
@@ -11,6 +19,20 @@ typedef struct {
     char *player_paths[MAX_PLAYERS];
     char *view_path;
     unsigned int seed;
+    event_backend_t backend;
+    move_transport_t transport;
+    rw_policy_t rw_policy;
+    unsigned int credits;
+    unsigned int games;
+    bool reuse;
+    unsigned int instances;
+    int think_ms;
+    bool overrun_blocks;
+    unsigned int max_moves;
+    bool async_view;
+    int layout;
+    char *record_path;
+    char *stats_path;
 } args_t;
 
 /**
@@ -18,11 +40,35 @@ typedef struct {
  * Supported options:
  *  -w <width>    Board width
  *  -h <height>   Board height
- *  -d <delay>    Delay in ms between frames for the view
+ *  -d <delay>    Delay in ms between frames for the view (with -a: minimum frame period)
  *  -t <timeout>  Seconds of inactivity (sin movimientos válidos) to end the game
+ *  -T <ms>       Think deadline per move (0 = none): a player owing a move for longer
+ *                is charged an invalid move, and again every further <ms>
+ *  -B            Block a player that overruns its think deadline instead
+ *  -M <moves>    End a game once its players made this many valid moves in total
+ *                (0 = none, the default: play until every player is blocked)
  *  -s <seed>     RNG seed (if omitted, a default seed is set beforehand)
  *  -v <view>     Path to view executable
- *  -p <player1> [player2 ...]  Player executable paths (1..MAX_PLAYERS)
+ *  -a            Asynchronous view: the master never waits for it; the view redraws at
+ *                its own pace and skips the rounds it missed
+ *  -e <backend>  Event backend for player pipes: epoll (default) or io_uring
+ *  -m <transport> Move transport: pipe (default) or ring (shared-memory rings; players
+ *                that do not support it keep using their pipe)
+ *  -k <credits>  Moves each player may have in flight (1..MAX_MOVE_CREDITS, default 1)
+ *  -n <games>    Number of consecutive games (seed, seed+1, ...); prints cumulative standings
+ *  -r            Reuse the same player processes, pipes and mappings across games
+ *  -j <games>    Concurrent games hosted by this master (1..MAX_INSTANCES), each
+ *                with its own segments and seed; not compatible with -v
+ *  -b <layout>   Board layout in shared memory: 1 (default, one int per cell, readable
+ *                by any player/view binary) or 2 (one byte per cell, 4x smaller; only
+ *                for binaries built from this tree, which detect it on their own)
+ *  -F <policy>   Reader/writer lock fairness: fifo (default), reader or writer
+ *  -o <file>     Record every game to file (.ccr) for the replay binary; needs -j 1
+ *  -S <file>     Append one line of statistics per game to file (key=value pairs:
+ *                moves, wall time, move round-trip percentiles, -T overruns, peak RSS)
+ *  -p <player1> [player2 ...]  Player executable paths (1..MAX_PLAYERS), or
+ *                lib:<path.so>[:<symbol>] to run a strategy inside the master
+ *                (one move in flight, whatever -k); both kinds can be mixed
  * The caller must initialize args with defaults (initialize_default_args) before calling.
  * Player paths appearing after -p (until next option starting with '-') are collected.
  *
@@ -0,0 +1,105 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "common.h"
+
+#define BENCH_SEEDS 3                 // every case runs with seeds 1..BENCH_SEEDS
+#define BENCH_THINK_MS "5"            // AI_TIME_ENV of the time-budgeted strategies (search, mcts)
+#define BENCH_THINK_DEADLINE_MS "1000" // master -T: a run where any move takes longer fails
+#define BENCH_INACTIVITY_S "2"        // master -t
+#define BENCH_TIMEOUT_MS 300000       // a run still going after this is killed and reported as failed
+#define BENCH_POLL_MS 5
+#define BENCH_TOLERANCE 0.25          // relative slowdown/growth reported as a regression
+#define BENCH_MIN_WALL_MS 100.0       // moves/s of shorter runs is mostly startup and scheduling: not compared
+#define BENCH_MIN_P99_MOVES 200       // p99 of fewer samples is the maximum, i.e. jitter: not compared
+#define BENCH_RTT_SLACK_US 2000       // absolute slack on top of the tolerance, per metric
+#define BENCH_RSS_SLACK_KB 1024
+#define BENCH_NAME_LEN 48
+
+/**
+ * One entry of the benchmark matrix; each runs once per seed.
+ */
+typedef struct {
+    unsigned short width, height;
+    int players;
+    const char *strategy;             // PLAYER_STRATEGY_ENV of every player
+    unsigned int max_moves;           // master -M, so long games stay short (0: play to the end)
+} bench_case_t;
+
+/**
+ * Measurements of one run, as read from the master's -S line. One TSV row of
+ * the output: case, seed, status, moves, wall_ms, moves_per_s, rtt_p50_us,
+ * rtt_p99_us, rss_master_kb, rss_player_kb (the largest player process).
+ */
+typedef struct {
+    char name[BENCH_NAME_LEN];        // <width>x<height>-<players>p-<strategy>
+    unsigned int seed;
+    bool ok;                          // the master exited 0, wrote its statistics and no move overran -T
+    unsigned int moves;
+    double wall_ms, moves_per_s;
+    unsigned int rtt_p50_us, rtt_p99_us;
+    long rss_master_kb, rss_player_kb;
+} bench_result_t;
+
+/**
+ * A case over all its seeds, as compared with the baseline: medians of the
+ * timings, maximum of the memory, ok only if every seed was.
+ */
+typedef struct {
+    bool ok;
+    double moves, wall_ms, moves_per_s, rtt_p99_us;
+    long rss_master_kb, rss_player_kb;
+} bench_summary_t;
+
+/**
+ * Command line of the bench binary:
+ *  bench [-m master] [-p player] [-f filter] [-o results.tsv] [-b baseline.tsv] [-t tolerance]
+ *  -m <master>   Master binary (default bin/master)
+ *  -p <player>   Player binary (default bin/player)
+ *  -f <text>     Only the cases whose name contains text
+ *  -o <file>     Also write the results to file (e.g. a new baseline)
+ *  -b <file>     Compare with a baseline written by -o; regressions make bench exit 1
+ *  -t <ratio>    Relative tolerance of the comparison (default BENCH_TOLERANCE)
+ * Results are printed to stdout as TSV with a header row.
+ */
+typedef struct {
+    const char *master;
+    const char *player;
+    const char *filter;
+    const char *out_path;
+    const char *baseline_path;
+    double tolerance;
+} bench_args_t;
+
+/**
+ * Parses the bench command line.
+ * @param argc Argument count from main
+ * @param argv Argument vector from main
+ * @param args Output
+ * @return 0 on success, -1 on error (message printed)
+ */
+int parse_bench_args(int argc, char **argv, bench_args_t *args);
+
+/**
+ * Runs the master headless on one case and seed and collects its statistics.
+ * @param args Bench settings
+ * @param bc Case to run
+ * @param seed Seed of the game
+ * @param result Output; result->ok is false if the run failed or timed out
+ */
+void run_bench_case(const bench_args_t *args, const bench_case_t *bc, unsigned int seed, bench_result_t *result);
+
+/**
+ * Compares results with a baseline case by case (bench_summary_t over the
+ * seeds) and prints every regression to stderr: moves/s down, or p99 RTT or
+ * peak RSS up, by more than the tolerance. Cases missing from either side
+ * are ignored.
+ * @param results Results of this run
+ * @param count Number of results
+ * @param baseline_path TSV written by a previous run (-o)
+ * @param tolerance Relative tolerance
+ * @return Number of regressions, or -1 if the baseline cannot be read
+ */
+int compare_with_baseline(const bench_result_t *results, int count, const char *baseline_path, double tolerance);
+
+#endif //BENCH_H
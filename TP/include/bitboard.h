@@ -0,0 +1,151 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "common.h"
+#include "util.h"
+
+#define BB_VALUE_PLANES 4   // cell values 1..9 fit in 4 bits
+
+/**
+ * Rows y0..y1 and words w0..w1 (inclusive) of a plane.
+ */
+typedef struct {
+    int y0, y1;
+    size_t w0, w1;
+} bb_rect_t;
+
+/**
+ * Free cells of a board as row bitsets: bit x of row y is set when (x, y) is
+ * free. Every plane holds height + 2 rows of stride 64-bit words; the first and
+ * last rows are zero padding so 8-neighbour dilation needs no bounds checks.
+ * Cell values are kept as bit-planes, so sums over a region are weighted popcounts.
+ */
+typedef struct {
+    unsigned short width, height;
+    size_t stride;                      // 64-bit words per row
+    size_t words;                       // words per plane, padding rows included
+    uint64_t *free;                     // free cells
+    uint64_t *value[BB_VALUE_PLANES];   // bit k of the value of each free cell
+    uint64_t *region;                   // last flood fill
+    uint64_t *frontier;                 // scratch: current distance layer
+    uint64_t *next;                     // scratch: next distance layer
+    uint64_t *spread;                   // scratch: horizontal dilation
+    uint64_t *store;                    // single allocation backing every plane
+    bb_rect_t band;                     // part of region/frontier/next/spread the last flood wrote
+    board_delta_t synced;               // game the free and value planes follow (bitboard_sync)
+    bool avx2;                          // dilate with AVX2 (CPU support, not built with NO_SIMD)
+} bitboard_t;
+
+/**
+ * Allocate an empty bitboard for a width x height board.
+ * On failure prints an error (perror) and returns NULL.
+ * @param width  Board width (>0)
+ * @param height Board height (>0)
+ * @return New bitboard or NULL on error
+ */
+bitboard_t *bitboard_create(unsigned short width, unsigned short height);
+
+/**
+ * Release a bitboard.
+ * @param bb Bitboard (NULL is ignored)
+ */
+void bitboard_destroy(bitboard_t *bb);
+
+/**
+ * Derive the free and value planes from a game state of the same size, reading
+ * every cell. The caller holds whatever lock gs needs.
+ * @param bb Bitboard
+ * @param gs Game state
+ */
+void bitboard_load(bitboard_t *bb, const game_state_t *gs);
+
+/**
+ * Bring the free and value planes up to date with gs: only the cells taken
+ * since the previous call are cleared (bitboard_take()), falling back to
+ * bitboard_load() on the first call, a new game or a state it cannot explain.
+ * The caller holds whatever lock gs needs.
+ * @param bb Bitboard
+ * @param gs Game state; the same pointer on every turn keeps updates incremental
+ */
+void bitboard_sync(bitboard_t *bb, const game_state_t *gs);
+
+/**
+ * Clear a cell from the free and value planes (e.g. after a simulated move).
+ * @param bb Bitboard
+ * @param x Column (in bounds)
+ * @param y Row (in bounds)
+ */
+void bitboard_take(bitboard_t *bb, int x, int y);
+
+/**
+ * One 8-neighbour dilation step over the whole board, restricted to free cells:
+ * dst = dilate(src) & free & ~exclude. dst may not alias src or exclude.
+ * Uses AVX2 when the CPU has it. Overwrites bb->spread.
+ * @param bb Bitboard
+ * @param dst Output plane
+ * @param src Input plane
+ * @param exclude Plane of cells to leave out, or NULL
+ * @return Number of cells set in dst
+ */
+int bitboard_expand(bitboard_t *bb, uint64_t *dst, const uint64_t *src, const uint64_t *exclude);
+
+/**
+ * Flood fill from (x, y) over free cells, one distance layer per dilation step.
+ * Stops after max_depth layers, or once the region holds at least max_cells
+ * cells. The region is left in bb->region, which is zero outside bb->band:
+ * layer d only touches the rows and words within d of the start, so the cost
+ * follows max_depth rather than the board size.
+ * @param bb Bitboard
+ * @param x Start column (must be free)
+ * @param y Start row
+ * @param max_depth Maximum distance (in king moves) from the start
+ * @param max_cells Region size at which to stop growing
+ * @param layers Output: cells at each distance 0..max_depth, or NULL
+ * @return Region size (0 if the start is not free)
+ */
+int bitboard_flood(bitboard_t *bb, int x, int y, int max_depth, int max_cells, int *layers);
+
+/**
+ * Sum of the values of the cells in a plane, as weighted popcounts.
+ * @param bb Bitboard
+ * @param plane Plane (e.g. bb->region)
+ * @param rect Part of the plane to sum (e.g. &bb->band), or NULL for all of it
+ * @return Sum of cell values
+ */
+int bitboard_value(const bitboard_t *bb, const uint64_t *plane, const bb_rect_t *rect);
+
+/**
+ * Number of cells set in a plane.
+ * @param bb Bitboard
+ * @param plane Plane
+ * @param rect Part of the plane to count, or NULL for all of it
+ * @return Cell count
+ */
+int bitboard_count(const bitboard_t *bb, const uint64_t *plane, const bb_rect_t *rect);
+
+/**
+ * First word of row y of a plane.
+ * @param bb Bitboard
+ * @param plane Plane
+ * @param y Row (-1 and height address the padding rows)
+ * @return Pointer to stride words
+ */
+static inline uint64_t *bitboard_row(const bitboard_t *bb, uint64_t *plane, int y) {
+    return plane + (size_t)(y + 1) * bb->stride;
+}
+
+/**
+ * Whether bit (x, y) is set in a plane.
+ * @param bb Bitboard
+ * @param plane Plane
+ * @param x Column (in bounds)
+ * @param y Row (in bounds)
+ * @return true if set
+ */
+static inline bool bitboard_test(const bitboard_t *bb, const uint64_t *plane, int x, int y) {
+    return (plane[(size_t)(y + 1) * bb->stride + (size_t)x / 64] >> (x % 64)) & 1u;
+}
+
+#endif //BITBOARD_H
@@ -2,14 +2,36 @@
 #define COMMON_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <semaphore.h>
 
 #define SHM_STATE "/game_state"
 #define SHM_SYNC  "/game_sync"
 
+#define SHM_INSTANCE_ENV "CHOMP_SHM_INSTANCE" // instance suffix handed to players and view (-j)
+#define SHM_INSTANCE_LEN 32
+#define SHM_NAME_LEN 64
+
 #define MAX_PLAYERS 9
 
+#define MAX_MOVE_CREDITS 32  // upper bound of the credit window (-k)
+#define SNAPSHOT_SPINS 64    // seqlock retries before a reader starts yielding
+#define MOVE_PLAN_CONT 0x08  // move byte flag: continues the sender's previous move (dir | MOVE_PLAN_CONT)
+
+#define BOARD_LAYOUT_V1 1           // one int per cell (original layout)
+#define BOARD_LAYOUT_V2 2           // board_header_t, then one int8_t per cell
+#define BOARD_V2_MAGIC 0x504d4843u  // "CHMP"; never a valid v1 cell value
+
+/**
+ * Start of the board area in the v2 layout. Readers detect the layout from the
+ * magic alone, so v1/v2 binaries need no flag to attach.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;   // BOARD_LAYOUT_V2
+} board_header_t;
+
 typedef struct {
     char name[16];
     unsigned int score;
@@ -26,9 +48,24 @@ typedef struct {
     unsigned int num_players;
     player_t players[MAX_PLAYERS];
     bool finished;
-    int board[];
+    int board[];    // v1: int cells; v2: board_header_t + int8_t cells. Use get_cell()/set_cell() (util.h)
 } game_state_t;
 
+/**
+ * Layout of a mapped or copied game state, read from the board header.
+ * @param gs Game state
+ * @return BOARD_LAYOUT_V1 or BOARD_LAYOUT_V2
+ */
+static inline int board_layout(const game_state_t *gs) {
+    return (*(const uint32_t *)(const void *)gs->board == BOARD_V2_MAGIC) ? BOARD_LAYOUT_V2 : BOARD_LAYOUT_V1;
+}
+
+typedef enum {
+    RW_POLICY_FIFO = 0,   // arrival order (default)
+    RW_POLICY_READER,     // readers enter while any reader holds the lock
+    RW_POLICY_WRITER      // a waiting writer holds back new readers
+} rw_policy_t;
+
 typedef struct {
     sem_t drawing_signal;
     sem_t not_drawing_signal;
@@ -37,18 +74,81 @@ typedef struct {
     sem_t reader_count_protect_signal;
     unsigned int reader_count;
     sem_t move_signal[MAX_PLAYERS];
+    unsigned int state_seq;   // seqlock over game_state_t: odd while the master is writing
+    unsigned int rw_state;    // futex rwlock word: reader count + writer/waiting/sleeper bits
+    unsigned int rw_ticket_next;
+    unsigned int rw_ticket_serving;
+    unsigned int rw_ticket_sleepers;
+    unsigned int rw_policy;   // rw_policy_t, fixed by the master before any process attaches
+    unsigned int move_credits; // credit window: moves a player may have in flight (initial move_signal value)
+    unsigned int players_reused;   // -r: players stay alive across games instead of exiting
+    unsigned int game_generation;  // futex word bumped by the master when a new game starts (or on shutdown)
+    unsigned int players_shutdown; // set with the last generation bump: reused players must exit
+    unsigned int player_game_ack[MAX_PLAYERS]; // futex words: generation + 1 once player i is idle after a game
+    unsigned int view_async;      // -a: the view follows view_generation instead of the drawing semaphores
+    unsigned int view_generation; // futex word bumped by the master whenever a round changed the state
+    unsigned int view_waiting;    // the view is (about to be) asleep on view_generation
+    unsigned int view_frame_ms;   // -a: minimum time between two frames (from -d)
 } sync_t;
 
+/**
+ * Size in bytes of the board area (cells plus the v2 header), computed in size_t.
+ * @param width  Board width
+ * @param height Board height
+ * @param layout BOARD_LAYOUT_V1 or BOARD_LAYOUT_V2
+ * @return Board size in bytes
+ */
+ size_t board_size(unsigned short width, unsigned short height, int layout);
+
+/**
+ * Size in bytes of a game_state_t holding a width x height board.
+ * @param width  Board width
+ * @param height Board height
+ * @param layout BOARD_LAYOUT_V1 or BOARD_LAYOUT_V2
+ * @return Total size (header + board)
+ */
+ size_t game_state_size(unsigned short width, unsigned short height, int layout);
+
+/**
+ * Copy a consistent snapshot of the shared game state (header, players and board)
+ * into dst without taking any semaphore. Uses sync->state_seq as a seqlock: the
+ * copy is retried while the master is inside writer_lock() or if it committed
+ * during the copy, so readers never stall the writer.
+ * @param dst Private buffer of at least game_state_size(src->width, src->height, board_layout(src)) bytes
+ * @param src Shared game state (typically the read-only mapping)
+ * @param sync Shared sync block
+ */
+ void snapshot_game_state(game_state_t *dst, const game_state_t *src, sync_t *sync);
+
+/**
+ * Select the game instance whose segments the following allocate/attach/cleanup
+ * calls refer to. The instance is a suffix appended to every segment name
+ * ("/game_state.<instance>"); the empty string keeps the plain names. Until this
+ * is called, the instance comes from the SHM_INSTANCE_ENV environment variable.
+ * @param instance Instance suffix, or NULL to reload it from the environment
+ */
+ void shm_set_instance(const char *instance);
+
+/**
+ * Build the name of a shared memory segment for the current instance.
+ * @param buf Output buffer (SHM_NAME_LEN bytes is always enough)
+ * @param len Capacity of buf
+ * @param base Base name, e.g. SHM_STATE
+ */
+ void shm_name(char *buf, size_t len, const char *base);
+
 /**
  * Allocate and map a shared memory segment for a game_state_t plus its board.
- * Size = sizeof(game_state_t) + (width * height * sizeof(int)). Memory is zeroed.
+ * Size = game_state_size(width, height, layout). Memory is zeroed; a v2 board
+ * gets its header written, so the layout is fixed from here on.
  * On failure prints an error (perror) and returns NULL.
  * Caller must later (once globally) call cleanup_shared_memory() to unlink the name; munmap is implicit on process exit.
  * @param width  Board width (>0)
  * @param height Board height (>0)
+ * @param layout BOARD_LAYOUT_V1 (int cells, for old binaries) or BOARD_LAYOUT_V2
  * @return Pointer to writable shared game_state_t or NULL on error.
  */
- game_state_t* allocate_game_state_shm(unsigned short width, unsigned short height);
+ game_state_t* allocate_game_state_shm(unsigned short width, unsigned short height, int layout);
 
 /**
  * Allocate and map a shared memory segment for synchronization primitives (sync_t).
@@ -0,0 +1,68 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "common.h"
+#include "util.h"
+
+#define COMPONENT_NONE (-1)
+
+/**
+ * Connected components (8-neighbour) of the free cells of a board, with their
+ * sizes and value sums, kept across turns. Each update removes the cells taken
+ * since the previous one (board_delta(), so -k plans of several moves stay
+ * incremental) one at a time: in O(1) when the cell's free neighbours stay
+ * connected around it, otherwise by searching from each side of the cut until
+ * all but one are found closed off, which costs about the size of the pieces
+ * split off. Anything else (new game, another state) falls back to a relabel.
+ */
+typedef struct {
+    unsigned short width, height;
+    board_delta_t synced;               // game the labels describe
+    int *label;                         // component of each cell, COMPONENT_NONE if not free
+    signed char *value;                 // value of each free cell
+    int *size;                          // cells per component
+    int *sum;                           // value per component
+    int *queue;                         // relabel and split BFS
+    uint32_t *stamp;                    // stamp[i] == generation: cell i seen by the current split search
+    uint32_t generation;
+    int count;                          // labels in use (a split adds new ones)
+    unsigned long relabels;             // full recomputes so far
+    unsigned long removals;             // cells removed incrementally so far
+    unsigned long splits;               // components split incrementally so far
+} components_t;
+
+/**
+ * Allocate an empty tracker for a width x height board.
+ * On failure prints an error (perror) and returns NULL.
+ * @param width  Board width (>0)
+ * @param height Board height (>0)
+ * @return New tracker or NULL on error
+ */
+components_t *components_create(unsigned short width, unsigned short height);
+
+/**
+ * Release a tracker.
+ * @param comps Tracker (NULL is ignored)
+ */
+void components_destroy(components_t *comps);
+
+/**
+ * Bring the labels up to date with gs (same size as the tracker). The caller
+ * holds whatever lock gs needs.
+ * @param comps Tracker
+ * @param gs Game state; the same pointer on every turn keeps updates incremental
+ */
+void components_update(components_t *comps, const game_state_t *gs);
+
+/**
+ * Component of a cell.
+ * @param comps Tracker
+ * @param x Column (in bounds)
+ * @param y Row (in bounds)
+ * @return Component label, or COMPONENT_NONE if the cell is not free
+ */
+static inline int components_label(const components_t *comps, int x, int y) {
+    return comps->label[(size_t)y * comps->width + (size_t)x];
+}
+
+#endif //COMPONENTS_H
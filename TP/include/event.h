@@ -0,0 +1,63 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+typedef enum {
+    EVENT_BACKEND_EPOLL = 0,
+    EVENT_BACKEND_IO_URING
+} event_backend_t;
+
+typedef struct event_loop event_loop_t;
+
+/**
+ * Parses a backend name ("epoll" or "io_uring") into an event_backend_t.
+ * @param name Backend name as given on the command line
+ * @param backend Output backend
+ * @return 0 on success, -1 if the name is unknown
+ */
+int parse_event_backend(const char *name, event_backend_t *backend);
+
+/**
+ * Creates an event loop for readability notifications on file descriptors.
+ * Descriptors are registered once with event_loop_add() and stay armed until
+ * event_loop_remove() is called; there is no per-wait rebuild like select().
+ * On failure prints an error (perror) and returns NULL.
+ * @param backend Notification backend (epoll or io_uring)
+ * @return Pointer to a new event loop or NULL on error
+ */
+event_loop_t *event_loop_create(event_backend_t backend);
+
+/**
+ * Registers a file descriptor for read readiness (level semantics: an fd with
+ * unread data or at EOF is reported on every wait).
+ * @param loop Event loop
+ * @param fd File descriptor to watch
+ * @param tag Non-negative caller value reported back by event_loop_wait()
+ * @return 0 on success, -1 on error
+ */
+int event_loop_add(event_loop_t *loop, int fd, int tag);
+
+/**
+ * Unregisters a file descriptor (e.g. after reading EOF). The fd is not closed.
+ * @param loop Event loop
+ * @param fd File descriptor previously registered
+ * @return 0 on success, -1 if the fd was not registered or on error
+ */
+int event_loop_remove(event_loop_t *loop, int fd);
+
+/**
+ * Waits until at least one registered fd is readable or the timeout expires.
+ * @param loop Event loop
+ * @param tags Output array filled with the tags of the ready fds
+ * @param max_tags Capacity of tags
+ * @param timeout_ms Maximum wait in milliseconds, -1 to wait forever
+ * @return Number of tags written (0 on timeout), -1 on error (errno set)
+ */
+int event_loop_wait(event_loop_t *loop, int *tags, int max_tags, int timeout_ms);
+
+/**
+ * Releases the event loop and its kernel resources. Registered fds are not closed.
+ * @param loop Event loop (NULL is ignored)
+ */
+void event_loop_destroy(event_loop_t *loop);
+
+#endif //EVENT_H
@@ -0,0 +1,105 @@
+#ifndef INPROC_H
+#define INPROC_H
+
+#include "common.h"
+#include "pool.h"
+#include "mirror.h"
+
+#define INPROC_PREFIX "lib:"                 // -p lib:<path.so>[:<symbol>]
+#define INPROC_DEFAULT_SYMBOL "choose_best_move"
+
+/**
+ * Strategy exported by a shared object; same contract as choose_best_move():
+ * fills move[2] with a direction vector and returns 0, or -1 without moves.
+ */
+typedef int (*strategy_fn_t)(int *move, const game_state_t *gs, sync_t *sync, int id);
+
+/**
+ * A player run inside the master: its strategy is called on a pool thread
+ * against a private mirror of the game_state_t, refreshed from deltas without
+ * locks (or against the shared state under reader_lock if the mirror could not
+ * be allocated), and the chosen move is handed back through result, announced
+ * on notify_fd. At most one move is in
+ * flight per player, whatever the credit window.
+ */
+typedef struct {
+    strategy_fn_t strategy;
+    void *handle;           // dlopen() handle
+    game_state_t *gs;
+    sync_t *sync;
+    board_mirror_t *mirror; // private copy the strategy reads, or NULL
+    int id;
+    int notify_fd;          // eventfd written by the worker when result is ready
+    unsigned int credits;   // moves granted by the master and not yet requested
+    unsigned int busy;      // a request is queued or running on the pool
+    unsigned int done;      // result ready; set by the worker, cleared by the master
+    int result;             // direction 0..7, or -1 when the strategy found no move
+} inproc_player_t;
+
+/**
+ * Whether a -p argument names an in-process strategy ("lib:..." prefix).
+ * @param path Player argument
+ * @return true for in-process players
+ */
+bool is_inproc_spec(const char *path);
+
+/**
+ * Loads the strategy named by spec ("lib:<path.so>[:<symbol>]", symbol defaults
+ * to INPROC_DEFAULT_SYMBOL). On failure prints an error and returns -1.
+ * @param player Player to fill (strategy and handle)
+ * @param spec -p argument
+ * @return 0 on success, -1 on error
+ */
+int inproc_load(inproc_player_t *player, const char *spec);
+
+/**
+ * Binds a loaded player to a game and resets it: no credits, nothing in flight.
+ * Allocates the player's mirror of gs on the first bind.
+ * @param player Loaded player
+ * @param gs Shared game state
+ * @param sync Sync block of the same game
+ * @param journal Move journal of the same game
+ * @param id Player index
+ * @param notify_fd eventfd the master watches for completed moves
+ */
+void inproc_bind(inproc_player_t *player, game_state_t *gs, sync_t *sync, const move_journal_t *journal, int id, int notify_fd);
+
+/**
+ * Master side: grants one move and queues a request on the pool if none is in flight.
+ * @param player In-process player
+ * @param pool Thread pool running strategies
+ */
+void inproc_grant(inproc_player_t *player, thread_pool_t *pool);
+
+/**
+ * Master side: takes the completed move, if any, and queues the next request
+ * when credits remain.
+ * @param player In-process player
+ * @param pool Thread pool running strategies
+ * @param move Output: direction 0..7, or -1 when the strategy gave up
+ * @return true if a move was taken
+ */
+bool inproc_collect(inproc_player_t *player, thread_pool_t *pool, int *move);
+
+/**
+ * Master side: drops the remaining credits, so no new request is queued once
+ * the one in flight (if any) completes.
+ * @param player In-process player
+ */
+void inproc_release(inproc_player_t *player);
+
+/**
+ * Master side: whether no request of the player is queued or running. A
+ * completed result is dropped. Does not block.
+ * @param player In-process player
+ * @return true once the player is idle
+ */
+bool inproc_idle(inproc_player_t *player);
+
+/**
+ * Releases the shared object and the mirror.
+ * @param player In-process player (not loaded: ignored)
+ */
+void inproc_unload(inproc_player_t *player);
+
+#endif //INPROC_H
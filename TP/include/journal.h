@@ -0,0 +1,101 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "common.h"
+
+#define SHM_JOURNAL "/game_journal"
+
+#define JOURNAL_CAPACITY 4096 // entries kept; power of two
+
+/**
+ * What a journal entry records: a move the player sent, or a decision of the
+ * master that is not a move (the board does not change, valid is false).
+ */
+enum {
+    JOURNAL_MOVE = 0,
+    JOURNAL_OVERRUN,           // -T: an invalid charged for running past the think deadline
+    JOURNAL_BLOCK              // the player was blocked with free cells around (-T -B overrun, closed pipe)
+};
+
+/**
+ * One committed move. seq is 0 while the master is rewriting the slot.
+ */
+typedef struct {
+    unsigned int seq;          // sequence number, 1 for the first move ever appended
+    unsigned char player;
+    bool valid;                // false: rejected, the board did not change
+    signed char value;         // cell value taken (0 when rejected)
+    unsigned char kind;        // JOURNAL_MOVE, JOURNAL_OVERRUN or JOURNAL_BLOCK
+    unsigned short from_x, from_y;
+    short to_x, to_y;          // target cell; may lie off the board when rejected
+} journal_entry_t;
+
+/**
+ * Append-only ring of the moves the master committed (and of the -T penalties
+ * and blocks it imposed), written by the master
+ * inside the writer critical section that applies them, so head and game read
+ * under the state seqlock match the board. Sequence numbers keep growing
+ * across games; game changes whenever the board is reinitialized.
+ */
+typedef struct {
+    pid_t owner;               // master pid; guards against stale segments
+    unsigned int game;         // bumped by journal_new_game()
+    unsigned int head __attribute__((aligned(64))); // seq of the newest entry, 0 if none
+    journal_entry_t entries[JOURNAL_CAPACITY] __attribute__((aligned(64)));
+} move_journal_t;
+
+/**
+ * Create and map the journal segment (SHM_JOURNAL), empty.
+ * On failure prints an error (perror) and returns NULL.
+ * @return Pointer to the writable segment or NULL on error.
+ */
+move_journal_t* allocate_journal_shm(void);
+
+/**
+ * Attach read-only to the journal segment created by the parent master.
+ * Fails silently (returns NULL) when the segment does not exist or belongs to
+ * another master; consumers then have to rescan the board.
+ * @return Pointer to the mapped segment or NULL.
+ */
+const move_journal_t* attach_journal_shm(void);
+
+/**
+ * Unlink SHM_JOURNAL. Errors are ignored (the segment may not exist).
+ */
+void cleanup_journal_shm(void);
+
+/**
+ * Master side: mark the board as reinitialized. Call with the writer lock
+ * held (or before any consumer runs).
+ * @param journal Journal segment
+ */
+void journal_new_game(move_journal_t *journal);
+
+/**
+ * Master side: append a move and publish it as the new head. Call with the
+ * writer lock held, together with the board update.
+ * @param journal Journal segment
+ * @param entry Move to append (its seq is assigned here)
+ */
+void journal_append(move_journal_t *journal, const journal_entry_t *entry);
+
+/**
+ * Consumer side: sequence number of the newest entry.
+ * @param journal Journal segment
+ * @return Head sequence number, 0 if nothing was appended yet
+ */
+unsigned int journal_head(const move_journal_t *journal);
+
+/**
+ * Consumer side: copy the entries following since, oldest first, up to max
+ * entries or the head. Entries already overwritten by newer ones cannot be
+ * recovered: the consumer must resync from the board.
+ * @param journal Journal segment
+ * @param since Last sequence number the consumer has seen
+ * @param out Output buffer
+ * @param max Capacity of out
+ * @return Number of entries copied, or -1 on overrun
+ */
+int journal_read(const move_journal_t *journal, unsigned int since, journal_entry_t *out, int max);
+
+#endif //JOURNAL_H
@@ -2,24 +2,144 @@
 #define MASTER_H
 
 #include "args.h"
+#include "ring.h"
+#include "journal.h"
+#include "record.h"
+#include "inproc.h"
 
 #define WIDTH_DEFAULT 10
 #define HEIGHT_DEFAULT 10
 #define DELAY_DEFAULT 200
 #define TIMEOUT_DEFAULT 10
+#define PENDING_MOVES 64
+#define RING_PIPE_POLL_MS 1   // ring mode: pipe-only players still connected
+#define RING_IDLE_POLL_MS 50  // ring mode: bound on a doorbell sleep (pipe EOF checks)
+#define REUSE_POLL_MS 10      // -r: bound on a sleep while waiting for a player to go idle
+#define PLAYER_EXIT_GRACE_MS 2000 // after a game: time players get to exit (or go idle with -r) before SIGKILL
+#define VIEW_EXIT_GRACE_MS 2000   // after a game: time the view gets to draw the last frame and exit before SIGKILL
+#define REAP_POLL_MS 1        // teardown: poll period for a child without a pidfd
+#define INSTANCE_SEGMENTS 4   // state, sync, move rings and move journal
+#define ENV_FORWARD_PREFIX "CHOMP_"  // master variables passed on to players and view (e.g. CHOMP_STRATEGY)
+#define ENV_FORWARD_MAX 16
+#define INPROC_TAG (MAX_INSTANCES * MAX_PLAYERS) // event loop tag of the strategy pool's eventfd
+#define TIMER_TAG (INPROC_TAG + 1)               // event loop tag of the deadline timerfd
+#define EXIT_SLOTS (MAX_PLAYERS + 1)             // pidfds per instance: one per player, then the view
+#define VIEW_SLOT MAX_PLAYERS
+#define EXIT_TAG (TIMER_TAG + 1)                 // pidfd tags: EXIT_TAG + index * EXIT_SLOTS + slot
+#define EVENT_TAGS (EXIT_TAG + MAX_INSTANCES * EXIT_SLOTS)
 
 /**
- * Prints the winners of the game after applying tiebreaker rules
- * @param gs: pointer to the game state
+ * Master-private bookkeeping for one player's move channel.
+ * Kept out of shared memory so the event loop never needs the game lock to
+ * know which pipes are still live.
  */
-void print_winners(game_state_t* gs);
+typedef struct {
+    int fd;        // read end of the player's pipe (non-blocking, registered in the event loop)
+    bool blocked;  // set once the pipe hit EOF and every queued move was committed
+    bool eof;      // pipe closed; the fd was already removed from the event loop
+    bool in_loop;  // fd currently registered in the event loop
+    unsigned char pending[PENDING_MOVES]; // FIFO of move bytes read but not yet committed
+    int pending_head, pending_count;
+    move_ring_t* ring; // shared-memory ring (-m ring), NULL in pipe mode; used once the player activates it
+    bool plan_broken;  // a move was rejected: drop MOVE_PLAN_CONT moves until the next plan starts
+    inproc_player_t* inproc; // in-process strategy (-p lib:...), NULL for executables; fd is -1 then
+    bool awaiting;     // the master has no move of this player queued: its think clock runs
+    long long think_since_ms; // CLOCK_MONOTONIC ms when the think clock (re)started
+    long long awaiting_since_us; // CLOCK_MONOTONIC us when the think clock started (-S round trips)
+    bool arrived;      // the round being played found a move of this player queued
+} player_channel_t;
 
 /**
- * Waits for all player processes and the view process to finish
+ * One validated move of a round, staged before the writer critical section.
+ */
+typedef struct {
+    int player;
+    int x, y;      // target cell (meaningless when the byte was not a direction)
+    bool valid;
+} round_commit_t;
+
+/**
+ * -S: measurements of the game an instance is playing. A move's round trip
+ * runs from the end of the round that left the master with nothing of that
+ * player to commit to the end of the round that found its next move.
+ */
+typedef struct {
+    unsigned int seed;
+    long long start_us;           // CLOCK_MONOTONIC us when the game started
+    long long end_us;             // CLOCK_MONOTONIC us when the game ended (before its teardown)
+    unsigned int first_seq;       // journal head when the game started
+    uint32_t* rtt_us;             // round trips of the game, in us
+    size_t rtt_count, rtt_capacity;
+    unsigned int overruns;        // moves that ran past the -T think deadline
+    long rss_kb[MAX_PLAYERS];     // peak RSS of each player process reaped after the game (0 if none)
+} game_stats_t;
+
+/**
+ * A finished game waiting for its view to exit and its players to exit (or
+ * go idle with -r). Each child is watched through a pidfd on the master's
+ * event loop and the grace periods feed the deadline timer, so the other
+ * instances keep playing meanwhile. The view goes first: the players' grace
+ * period starts once it is gone.
+ */
+typedef struct {
+    bool active;
+    bool reuse;                        // -r with games left: players go idle instead of exiting
+    bool poll;                         // something is only seen by polling (no pidfd, -r acks)
+    bool poked;                        // a pidfd of the instance became readable
+    bool waiting[EXIT_SLOTS];          // child still to be reaped, or player still to go idle
+    bool killed[EXIT_SLOTS];           // SIGKILL already sent
+    int pidfds[EXIT_SLOTS];            // -1 when the child has none
+    int exit_codes[MAX_PLAYERS];
+    long long view_deadline_ms;        // SIGKILL the view past this
+    long long players_deadline_ms;     // SIGKILL players past this; LLONG_MAX while the view runs
+} teardown_t;
+
+/**
+ * One game hosted by the master (-j): its own segments, sync_t, channels and
+ * round state. Every instance shares the master's single event loop; fds are
+ * registered with tag index * MAX_PLAYERS + player.
+ */
+typedef struct {
+    int index;
+    char shm_instance[SHM_INSTANCE_LEN];  // segment name suffix ("" with a single instance)
+    char shm_names[INSTANCE_SEGMENTS][SHM_NAME_LEN]; // precomputed for teardown from a signal handler
+    char env_entry[sizeof(SHM_INSTANCE_ENV) + SHM_INSTANCE_LEN]; // SHM_INSTANCE_ENV=<shm_instance>
+    char* envp[ENV_FORWARD_MAX + 2];      // environment of the instance's players and view
+    game_state_t* gs;
+    sync_t* sync;
+    move_rings_t* rings;                  // NULL in pipe mode
+    move_journal_t* journal;
+    uint8_t* mobility;                    // free-neighbour count of every cell, rebuilt every game
+    uint8_t* mobility_scratch;            // FREE_NEIGHBOR_SCRATCH(width) bytes for free_neighbor_map()
+    recorder_t* recorder;                 // -o, NULL when not recording
+    game_stats_t stats;                   // -S
+    player_channel_t channels[MAX_PLAYERS];
+    inproc_player_t inproc[MAX_PLAYERS];  // loaded strategies of in-process players
+    pid_t view;                           // -1 when there is no view running
+    unsigned int games_played;
+    bool players_running;
+    bool done;                            // played its args->games games
+    long long last_successful_move_ms;    // CLOCK_MONOTONIC ms
+    int start_player;
+    bool pending;                         // moves queued from the previous round
+    teardown_t teardown;                  // game over, children not yet reaped (or idle with -r)
+} game_instance_t;
+
+/**
+ * Cumulative results of one player over a series of games (-n).
+ */
+typedef struct {
+    unsigned int wins;  // games won outright or tied for first
+    unsigned long long score, valids, invalids;
+} standing_t;
+
+/**
+ * Prints the winners of the game after applying tiebreaker rules
  * @param gs: pointer to the game state
- * @param view: view process PID
+ * @param winners: output array (MAX_PLAYERS entries) with the winners' indices, or NULL
+ * @return: number of winners (more than one on a tie)
  */
-void wait_all(game_state_t* gs, pid_t view);
+int print_winners(game_state_t* gs, int winners[]);
 
 /**
  * Sets valid positions for a player on the game board
@@ -29,11 +149,11 @@ void wait_all(game_state_t* gs, pid_t view);
 void set_valid_positions(game_state_t* gs, int player_pos);
 
 /**
- * Closes all file descriptors in the provided array
- * @param fds: array of file descriptor pairs
- * @param num_players: number of players (size of fds array)
+ * Closes the read end of every player channel
+ * @param channels: array of player channels
+ * @param num_players: number of players (size of channels array)
  */
-void close_fds(int fds[][2], int num_players);
+void close_fds(player_channel_t channels[], int num_players);
 
 /**
  * Initializes the args structure with default values
@@ -54,9 +174,10 @@ void init_game_state(game_state_t* gs, args_t* args, int num_players);
  * @param view_path: path to the view executable
  * @param width_s: string representation of the board width
  * @param height_s: string representation of the board height
+ * @param envp: environment of the view (carries SHM_INSTANCE_ENV and the master's CHOMP_* variables)
  * @return PID of the created view process, or -1 on failure
  */
-pid_t create_view_process(const char* view_path, const char* width_s, const char* height_s);
+pid_t create_view_process(const char* view_path, const char* width_s, const char* height_s, char* const envp[]);
 
 /**
  * Creates a player process to participate in the game
@@ -64,9 +185,10 @@ pid_t create_view_process(const char* view_path, const char* width_s, const char
  * @param width_s: string representation of the board width
  * @param height_s: string representation of the board height
  * @param pipe_fd: array of two integers representing the pipe file descriptors (pipe_fd[0] for reading, pipe_fd[1] for writing)
+ * @param envp: environment of the player (carries SHM_INSTANCE_ENV and the master's CHOMP_* variables)
  * @return PID of the created player process, or -1 on failure
  */
-pid_t create_player_process(const char* player_path, const char* width_s, const char* height_s, int pipe_fd[2]);
+pid_t create_player_process(const char* player_path, const char* width_s, const char* height_s, int pipe_fd[2], char* const envp[]);
 
 /**
  * Starts the view process by signaling it to begin drawing
@@ -75,40 +197,129 @@ pid_t create_player_process(const char* player_path, const char* width_s, const
 void start_view (sync_t* sync);
 
 /**
- * Main gameplay loop handling player turns, timeouts, and game state updates
- * @param gs: pointer to the game state
- * @param sync: pointer to the synchronization structure
+ * Main gameplay loop: runs args->games games on every instance, multiplexing
+ * all of them on one event loop. Each wake-up drains the ready pipes and runs
+ * one round (commit, timeout and blocked checks, view update) per instance;
+ * a finished instance tears down on the same loop (see teardown_t), then
+ * starts its next game.
+ * @param instances: instances already set up (segments mapped)
+ * @param num_instances: number of concurrent games (-j)
  * @param args: pointer to the args structure with game settings
- * @param fds: array of file descriptor pairs for player communication
- * @param num_players: number of players in the game
- * @param max_fd: maximum file descriptor value for select()
+ * @param num_players: number of players in each game
+ * @param loop: event loop used to wait for player moves
+ * @param width_s: board width as passed to players and view
+ * @param height_s: board height as passed to players and view
+ * @param standings: cumulative results, updated after every game
  */
-void play(game_state_t* gs, sync_t* sync, const args_t* args, int fds[][2], int num_players, int max_fd);
+void play(game_instance_t instances[], int num_instances, const args_t* args, int num_players,
+          event_loop_t* loop, const char* width_s, const char* height_s, standing_t standings[]);
 
 /**
  * Checks if the game has timed out and marks it as finished if so
  * @param gs: pointer to the game state
  * @param sync: pointer to the synchronization structure
  * @param args: pointer to the args structure with timeout setting
- * @param last_successful_move_time: timestamp of the last successful move
+ * @param last_successful_move_ms: monotonic time (ms) of the last successful move
+ * @param now_ms: current monotonic time (ms)
+ */
+void check_timeout_and_finish(game_state_t* gs, sync_t* sync, const args_t* args, long long last_successful_move_ms, long long now_ms);
+
+/**
+ * Marks the game as finished once its players made args->max_moves valid moves
+ * in total (-M). Only the master writes the counters: no lock is taken to read them.
+ * @param gs: pointer to the game state
+ * @param sync: pointer to the synchronization structure
+ * @param args: pointer to the args structure with the move limit (0: none)
+ * @param num_players: number of players in the game
  */
-void check_timeout_and_finish(game_state_t* gs, sync_t* sync, const args_t* args, time_t last_successful_move_time);
+void check_move_limit_and_finish(game_state_t* gs, sync_t* sync, const args_t* args, int num_players);
 
 /**
- * Checks if all players are blocked and marks the game as finished if so
+ * Checks if all players are blocked and marks the game as finished if so.
+ * Uses the master-private blocked flags; no lock is taken unless the game ends.
  * @param gs: pointer to the game state
  * @param sync: pointer to the synchronization structure
+ * @param channels: master-private player channels
+ * @param num_players: number of players in the game
  */
-void check_all_blocked_and_finish(game_state_t* gs, sync_t* sync);
+void check_all_blocked_and_finish(game_state_t* gs, sync_t* sync, const player_channel_t channels[], int num_players);
 
 /**
- * Handles a player event (move) and updates game state accordingly
- * @param player_idx: index of the player making the move
+ * Reads every byte currently available on a player's pipe into its pending queue
+ * (one read() per batch instead of one per move). No lock is taken.
+ * On EOF the channel is flagged and its fd is removed from the event loop; the
+ * player becomes blocked once its queued moves have been committed.
+ * @param channel: the player's channel (fd must be non-blocking)
+ * @param loop: event loop the channel is registered in
+ * @return: number of move bytes queued
+ */
+int drain_player_channel(player_channel_t* channel, event_loop_t* loop);
+
+/**
+ * Moves everything queued in a player's shared-memory ring into its pending
+ * queue. A closed ring counts as EOF. Does nothing for pipe players.
+ * @param channel: the player's channel
+ * @param loop: event loop the channel's pipe is registered in
+ * @return: number of move bytes queued
+ */
+int drain_player_ring(player_channel_t* channel, event_loop_t* loop);
+
+/**
+ * Commit stage of a round: takes the oldest pending move of every player
+ * (round-robin from start_player), validates it with is_valid_move() against
+ * the master's own view of the board plus cells claimed earlier in the same
+ * round, and applies all of them in a single writer_lock() section. Players
+ * that reached EOF with nothing queued, or whose head has no free neighbour
+ * left (looked up in mobility, which the section keeps up to date), are
+ * marked blocked in the same section.
+ * Each processed move grants the player a new credit afterwards (its ring
+ * credit if it switched to the ring, move_signal otherwise). With a credit
+ * window (move_credits > 1), once a move is invalid the rest of that player's
+ * plan (bytes flagged MOVE_PLAN_CONT) is rejected: dropped without being
+ * counted, with its credits returned. At -k 1 the flag has no meaning and any
+ * byte above 7 is an invalid move.
+ * Every processed move, valid or not, is appended to the journal in the same
+ * section, plus a JOURNAL_BLOCK entry for each player blocked by its closed pipe.
  * @param gs: pointer to the game state
  * @param sync: pointer to the synchronization structure
- * @param player_fd: file descriptor to read the player's move from
- * @param last_successful_move_time: pointer to timestamp of last successful move
+ * @param journal: move journal
+ * @param mobility: free-neighbour count of every cell, as built by free_neighbor_map()
+ * @param channels: master-private player channels
+ * @param num_players: number of players in the game
+ * @param start_player: player that goes first this round
+ * @return: number of valid moves applied
+ */
+int commit_round(game_state_t* gs, sync_t* sync, move_journal_t* journal, uint8_t* mobility, player_channel_t channels[], int num_players,
+                 int start_player);
+
+/**
+ * Grants one more move to every player still connected, so players parked on
+ * their credit wake up, see gs->finished and stop planning. In-process players
+ * get no further request; the one in flight, if any, is left to complete.
+ * @param sync: pointer to the synchronization structure
+ * @param channels: master-private player channels
+ * @param num_players: number of players in the game
+ */
+void release_players(sync_t* sync, player_channel_t channels[], int num_players);
+
+/**
+ * -r: resets the board and the channels for the next game and refills every
+ * credit window, then bumps game_generation to wake the parked players.
+ * @param gs: pointer to the game state
+ * @param sync: pointer to the synchronization structure
+ * @param args: game settings (args->seed already set for the new game)
+ * @param channels: master-private player channels
+ * @param num_players: number of players in the game
+ * @param rings: move rings segment or NULL
+ * @param journal: move journal
+ */
+void start_next_game(game_state_t* gs, sync_t* sync, args_t* args, player_channel_t channels[], int num_players, move_rings_t* rings,
+                     move_journal_t* journal);
+
+/**
+ * -r: tells parked players that no game follows, so they exit.
+ * @param sync: pointer to the synchronization structure
  */
-void handle_player_event(int player_idx, game_state_t* gs, sync_t* sync, int player_fd, time_t* last_successful_move_time);
+void stop_reused_players(sync_t* sync);
 
 #endif //MASTER_H
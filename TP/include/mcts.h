@@ -0,0 +1,29 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "common.h"
+
+#define MCTS_MAX_WORKERS 32         // trees searched in parallel per move (calling thread included)
+#define MCTS_ARENA_NODES (1 << 16)  // tree nodes per worker; once full, the tree stops growing
+#define MCTS_ROLLOUT_PLIES 48       // random moves per rollout before it is scored
+#define MCTS_EXPLORATION 1.41f      // UCT exploration constant
+
+/**
+ * Chooses a move by root-parallel Monte Carlo Tree Search between the player
+ * and its nearest opponent. Every online CPU grows an independent tree (UCT
+ * selection, light random rollouts driven by a per-worker xorshift RNG) on a
+ * private copy of the state, the extra ones as tasks on a thread pool kept for
+ * the whole process. Concurrent callers (in-process players) only borrow idle
+ * workers, so a move never waits for another one. Nodes come from a per-worker arena that is reset every
+ * move. When the ai_time_budget_ms() budget expires, the root move with the
+ * most visits summed over all trees is played.
+ * Same contract as choose_best_move().
+ * @param move: output array [2] to store the chosen direction vector
+ * @param gs: pointer to the game state
+ * @param sync: pointer to synchronization structures, or NULL if gs is a private snapshot
+ * @param id: player ID
+ * @return: 0 if a valid move is found, -1 if no moves available
+ */
+int choose_best_move_mcts(int *move, const game_state_t *gs, sync_t *sync, int id);
+
+#endif //MCTS_H
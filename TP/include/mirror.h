@@ -0,0 +1,56 @@
+#ifndef MIRROR_H
+#define MIRROR_H
+
+#include "common.h"
+#include "journal.h"
+
+#define MIRROR_JOURNAL_BATCH 64 // journal entries copied per journal_read()
+
+/**
+ * Private copy of a shared game_state_t kept up to date from deltas. Each
+ * update copies only the header (player table) under the seqlock, then marks
+ * the cells taken since the previous update: with a move journal, those of the
+ * valid entries appended meanwhile; without one, the cell each player's new
+ * head consumed, which needs at most one valid move per player between two
+ * updates. Anything else (first update, new game, journal overrun, several
+ * moves of one player without a journal, simulated moves that were rejected)
+ * copies the whole state.
+ */
+typedef struct {
+    game_state_t *state;        // private header, player table and board (same layout as the shared one)
+    size_t size;
+    const move_journal_t *journal; // NULL: deltas are guessed from the player table
+    unsigned int journal_seq;   // last journal entry applied to state
+    unsigned int journal_game;  // journal game of state
+    unsigned int synced_valids[MAX_PLAYERS]; // valids as of the last update, before simulated moves
+    unsigned long full_syncs;   // whole-state copies so far
+    unsigned long delta_syncs;  // header-only updates so far
+} board_mirror_t;
+
+/**
+ * Allocate an empty mirror of a shared state; the first update copies it whole.
+ * On failure prints an error (perror) and returns NULL.
+ * @param shared Shared game state (only its size and layout are read)
+ * @param journal Move journal of the shared state, or NULL
+ * @return New mirror or NULL on error
+ */
+board_mirror_t *mirror_create(const game_state_t *shared, const move_journal_t *journal);
+
+/**
+ * Release a mirror.
+ * @param mirror Mirror (NULL is ignored)
+ */
+void mirror_destroy(board_mirror_t *mirror);
+
+/**
+ * Bring mirror->state up to date with the shared state, without taking any
+ * lock. The caller may have applied its own moves to mirror->state (head,
+ * claimed cell, valids++ as plan_moves() does): they are kept if the master
+ * accepted them all.
+ * @param mirror Mirror
+ * @param shared Shared game state
+ * @param sync Sync block whose state_seq guards the shared state
+ */
+void mirror_update(board_mirror_t *mirror, const game_state_t *shared, sync_t *sync);
+
+#endif //MIRROR_H
@@ -3,8 +3,13 @@
 
 #include "common.h"
 
+#define PLAYER_ID_RETRIES 100
+#define PLAYER_ID_RETRY_US 1000
+#define PLAYER_STRATEGY_ENV "CHOMP_STRATEGY"  // voronoi (default), search, mcts, flood or naive
+
 /**
- * Finds the player ID (index) in the game state based on process ID
+ * Finds the player ID (index) in the game state based on process ID.
+ * Retries for a short while, since the master writes the pid after fork().
  * @param gs: pointer to the game state
  * @param pid: process ID to search for
  * @return: player index (0 to MAX_PLAYERS-1) if found, -1 if not found
@@ -0,0 +1,48 @@
+#ifndef POOL_H
+#define POOL_H
+
+typedef struct thread_pool thread_pool_t;
+
+typedef void (*pool_task_fn)(void *arg);
+
+/**
+ * Create a fixed-size pool of worker threads fed from a bounded FIFO of tasks.
+ * On failure prints an error (perror) and returns NULL.
+ * @param threads Number of worker threads (< 1 uses the number of online CPUs)
+ * @param capacity Maximum number of queued (not yet started) tasks
+ * @return Pointer to a new pool or NULL on error
+ */
+thread_pool_t *pool_create(int threads, int capacity);
+
+/**
+ * Queue a task; some worker will run fn(arg). Never blocks.
+ * @param pool Thread pool
+ * @param fn Task function
+ * @param arg Argument passed to fn
+ * @return 0 on success, -1 if the queue is full
+ */
+int pool_submit(thread_pool_t *pool, pool_task_fn fn, void *arg);
+
+/**
+ * Queue a task only if an idle worker will start it right away. Never blocks.
+ * @param pool Thread pool
+ * @param fn Task function
+ * @param arg Argument passed to fn
+ * @return 0 on success, -1 if every worker is busy (or the queue is full)
+ */
+int pool_try_submit(thread_pool_t *pool, pool_task_fn fn, void *arg);
+
+/**
+ * Number of worker threads of the pool.
+ * @param pool Thread pool
+ * @return Worker count
+ */
+int pool_threads(const thread_pool_t *pool);
+
+/**
+ * Run every queued task, join the workers and release the pool.
+ * @param pool Thread pool (NULL is ignored)
+ */
+void pool_destroy(thread_pool_t *pool);
+
+#endif //POOL_H
@@ -0,0 +1,162 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "common.h"
+#include "journal.h"
+#include <stdio.h>
+
+#define RECORD_MAGIC 0x31524343u    // "CCR1"
+#define RECORD_VERSION 2            // 2: RECORD_BLOCK
+#define RECORD_KEYFRAME_MOVES 1024  // moves between two keyframes of a game
+#define RECORD_NO_DIR 8             // move byte that was not a direction, or a -T overrun (always invalid)
+#define RECORD_BLOCK 9              // not a move: the master blocked the player (always invalid)
+
+/**
+ * Recording file (.ccr): a record_header_t followed by a stream of records,
+ * each starting with a varint (LEB128) tag:
+ *  REC_GAME      varint seed, then a keyframe: a new game starts
+ *  REC_KEYFRAME  varint move number, player_t[num_players], width*height int8
+ *                cells: the whole state after that many moves of the game
+ *  REC_END       a keyframe with the final state (finished)
+ *  >= REC_MOVE   a move: tag - REC_MOVE = player + MAX_PLAYERS * (valid + 2 * dir),
+ *                dir relative to the player's head (RECORD_NO_DIR if none,
+ *                RECORD_BLOCK for a block),
+ *                followed by a varint of the milliseconds since the previous move
+ * Keyframes every RECORD_KEYFRAME_MOVES moves let a reader seek without
+ * replaying the game from its start.
+ */
+enum { REC_GAME = 0, REC_KEYFRAME, REC_END, REC_MOVE };
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t player_size;           // sizeof(player_t) of the writer
+    uint16_t width, height;
+    uint8_t num_players;
+    uint8_t layout;                 // board layout the games were played with
+    uint32_t seed;                  // seed of the first game
+    uint32_t keyframe_moves;
+    char names[MAX_PLAYERS][16];
+} record_header_t;
+
+/**
+ * Master side: writes the games of one instance as they are played, reading
+ * the committed moves from the move journal.
+ */
+typedef struct {
+    FILE *file;
+    unsigned int seq;               // last journal entry recorded
+    unsigned int moves;             // moves recorded in the current game
+    unsigned int since_keyframe;
+    long long last_move_ms;         // CLOCK_MONOTONIC ms of the previous move
+    bool header_written;
+} recorder_t;
+
+/**
+ * A decoded record. For keyframes, players and cells point into the file.
+ */
+typedef struct {
+    int type;                       // REC_GAME, REC_KEYFRAME, REC_END or REC_MOVE
+    unsigned int seed;              // REC_GAME
+    unsigned int move;              // keyframes: moves of the game before it
+    const player_t *players;        // keyframes (may be unaligned: copy with memcpy)
+    const int8_t *cells;            // keyframes, row-major
+    int player, dir;                // REC_MOVE
+    bool valid;                     // REC_MOVE
+    unsigned int delay_ms;          // REC_MOVE: time since the previous move
+} record_event_t;
+
+/**
+ * Read side: a recording mapped in memory.
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    const record_header_t *header;
+    size_t pos;                     // offset of the next record
+} record_reader_t;
+
+/**
+ * Create (truncate) a recording file. On failure prints an error (perror)
+ * and returns NULL.
+ * @param path File to write
+ * @return New recorder or NULL on error
+ */
+recorder_t *recorder_open(const char *path);
+
+/**
+ * Flush and close the recording.
+ * @param rec Recorder (NULL is ignored)
+ * @return 0 on success, -1 if any write failed
+ */
+int recorder_close(recorder_t *rec);
+
+/**
+ * Record the start of a game: the file header on the first call, then the
+ * seed and the initial state. Moves already in the journal are skipped.
+ * @param rec Recorder
+ * @param gs Game state just initialized (players placed)
+ * @param journal Move journal of the same game
+ * @param seed Seed of the game
+ */
+void record_game(recorder_t *rec, const game_state_t *gs, const move_journal_t *journal, unsigned int seed);
+
+/**
+ * Record the journal entries appended since the previous call, plus a
+ * keyframe every RECORD_KEYFRAME_MOVES moves. Call from the master thread
+ * right after the moves were committed.
+ * @param rec Recorder
+ * @param gs Game state (the master's, matching the journal head)
+ * @param journal Move journal
+ */
+void record_moves(recorder_t *rec, const game_state_t *gs, const move_journal_t *journal);
+
+/**
+ * Record the end of a game with its final state.
+ * @param rec Recorder
+ * @param gs Final game state
+ */
+void record_end(recorder_t *rec, const game_state_t *gs);
+
+/**
+ * Map a recording and check its header. On failure prints an error and
+ * returns -1.
+ * @param reader Reader to fill
+ * @param path Recording file
+ * @return 0 on success, -1 on error
+ */
+int record_reader_open(record_reader_t *reader, const char *path);
+
+/**
+ * Unmap a recording.
+ * @param reader Reader
+ */
+void record_reader_close(record_reader_t *reader);
+
+/**
+ * Decode the record at reader->pos and advance past it.
+ * @param reader Reader
+ * @param ev Output event
+ * @return 1 if a record was read, 0 at the end of the file, -1 if it is truncated or corrupt
+ */
+int record_next(record_reader_t *reader, record_event_t *ev);
+
+/**
+ * Overwrite the header, the player table and the board of gs with a keyframe.
+ * @param reader Reader the keyframe came from
+ * @param ev REC_GAME, REC_KEYFRAME or REC_END event
+ * @param gs Game state allocated for the recording's dimensions and layout
+ */
+void record_load_keyframe(const record_reader_t *reader, const record_event_t *ev, game_state_t *gs);
+
+/**
+ * Apply a recorded move to gs the way the master committed it (an invalid
+ * counts as one, a RECORD_BLOCK blocks the player), and mark the players left
+ * without a free neighbour as blocked.
+ * @param ev REC_MOVE event
+ * @param gs Game state
+ * @return 0 on success, -1 if the move does not fit gs (corrupt recording)
+ */
+int record_apply_move(const record_event_t *ev, game_state_t *gs);
+
+#endif //RECORD_H
@@ -0,0 +1,43 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "record.h"
+
+/**
+ * Command line of the replay binary:
+ *  replay [-v view] [-x speed] [-s move] [-g game] file.ccr
+ *  -v <view>   Drive this view binary, one frame per move (default: headless)
+ *  -x <speed>  Playback speed relative to the recorded timing; 0 (default)
+ *              replays as fast as possible
+ *  -s <move>   Start every game at this move (seeks through the keyframes)
+ *  -g <game>   Replay only this game of the file (1-based)
+ */
+typedef struct {
+    const char *path;
+    char *view_path;
+    double speed;
+    unsigned int seek;
+    unsigned int game;
+} replay_args_t;
+
+/**
+ * Parses the replay command line.
+ * @param argc Argument count from main
+ * @param argv Argument vector from main
+ * @param args Output
+ * @return 0 on success, -1 on error (message printed)
+ */
+int parse_replay_args(int argc, char **argv, replay_args_t *args);
+
+/**
+ * Positions the reader at the last keyframe of the current game taken at or
+ * before move target, skipping the moves in between without applying them.
+ * @param reader Reader positioned right after the game's REC_GAME record
+ * @param start REC_GAME event of the game (its initial keyframe)
+ * @param target Move to seek to
+ * @param keyframe Output: the keyframe to load (start if none is closer)
+ * @return 0 on success, -1 if the recording is corrupt
+ */
+int seek_keyframe(record_reader_t *reader, const record_event_t *start, unsigned int target, record_event_t *keyframe);
+
+#endif //REPLAY_H
@@ -0,0 +1,122 @@
+#ifndef RING_H
+#define RING_H
+
+#include "common.h"
+
+#define SHM_MOVES "/game_moves"
+
+#define MOVE_RING_SIZE 64 // power of two; must be >= MAX_MOVE_CREDITS
+
+/**
+ * Single-producer (player) / single-consumer (master) ring of move bytes.
+ * Producer and consumer indices live on separate cache lines. The credits
+ * word replaces move_signal[] for players that switched to the ring.
+ */
+typedef struct {
+    unsigned int tail __attribute__((aligned(64))); // written by the player
+    unsigned int active;          // player uses the ring instead of its pipe
+    unsigned int closed;          // player will not produce more moves
+    unsigned int credit_waiting;  // player is (about to be) asleep on credits
+    unsigned int head __attribute__((aligned(64))); // written by the master
+    unsigned int credits;         // futex word: moves the player may still send
+    unsigned char slots[MOVE_RING_SIZE] __attribute__((aligned(64)));
+} move_ring_t;
+
+typedef struct {
+    pid_t owner;                  // master pid; guards against stale segments
+    unsigned int doorbell __attribute__((aligned(64))); // futex word bumped on every push
+    unsigned int master_waiting;  // master is (about to be) asleep on doorbell
+    move_ring_t rings[MAX_PLAYERS];
+} move_rings_t;
+
+/**
+ * Create and map the move rings segment (SHM_MOVES). Every ring starts empty
+ * with the given credits, matching the initial value of move_signal[].
+ * On failure prints an error (perror) and returns NULL.
+ * @param credits Credit window (sync_t::move_credits)
+ * @return Pointer to the writable segment or NULL on error.
+ */
+move_rings_t* allocate_move_rings_shm(unsigned int credits);
+
+/**
+ * Reset every ring to empty, inactive and holding credits credits; claims the
+ * segment for the calling process. Only valid while no player is attached.
+ * @param rings Move rings segment
+ * @param credits Credit window (sync_t::move_credits)
+ */
+void init_move_rings(move_rings_t *rings, unsigned int credits);
+
+/**
+ * Attach to the move rings segment created by the parent master.
+ * Fails silently (returns NULL) when the segment does not exist or belongs to
+ * another master, so players fall back to the pipe protocol.
+ * @return Pointer to the mapped segment or NULL.
+ */
+move_rings_t* attach_move_rings_shm(void);
+
+/**
+ * Unlink SHM_MOVES. Errors are ignored (the segment may not exist).
+ */
+void cleanup_move_rings_shm(void);
+
+/**
+ * Producer side: enqueue a move byte and ring the master's doorbell.
+ * The futex wake is only issued if the master is sleeping.
+ * @param rings Move rings segment
+ * @param id Player index
+ * @param mov Move byte (direction 0..7)
+ */
+void move_ring_push(move_rings_t *rings, int id, unsigned char mov);
+
+/**
+ * Producer side: take one credit, spinning briefly and then sleeping on the
+ * credits futex until the master grants one.
+ * @param ring The player's ring
+ */
+void move_ring_take_credit(move_ring_t *ring);
+
+/**
+ * Producer side: announce that no more moves will be sent and wake the master.
+ * @param rings Move rings segment
+ * @param id Player index
+ */
+void move_ring_close(move_rings_t *rings, int id);
+
+/**
+ * Consumer side: dequeue up to max move bytes without blocking.
+ * @param ring Ring to read
+ * @param out Output buffer
+ * @param max Capacity of out
+ * @return Number of bytes dequeued
+ */
+int move_ring_pop(move_ring_t *ring, unsigned char *out, int max);
+
+/**
+ * Consumer side: whether the ring holds moves not yet dequeued.
+ * @param ring Ring to check
+ * @return true if move_ring_pop() would return at least one byte
+ */
+bool move_ring_has_data(move_ring_t *ring);
+
+/**
+ * Consumer side: grant one credit and wake the player if it is sleeping.
+ * @param ring Ring of the player
+ */
+void move_ring_grant_credit(move_ring_t *ring);
+
+/**
+ * Consumer side: current doorbell value, to be read before checking the rings.
+ * @param rings Move rings segment
+ * @return Doorbell value
+ */
+unsigned int move_rings_doorbell(move_rings_t *rings);
+
+/**
+ * Consumer side: wait until the doorbell moves past seen (adaptive spin, then futex).
+ * @param rings Move rings segment
+ * @param seen Doorbell value read before the rings were found empty
+ * @param timeout_ms Maximum sleep in milliseconds, -1 to wait forever
+ */
+void move_rings_wait(move_rings_t *rings, unsigned int seen, int timeout_ms);
+
+#endif //RING_H
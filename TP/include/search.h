@@ -0,0 +1,28 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "common.h"
+
+#define SEARCH_MAX_DEPTH 64
+#define SEARCH_TT_BITS 16                  // transposition table of 2^16 entries per thread
+#define SEARCH_EVAL_RADIUS 16              // leaves count territory within this many moves of the heads
+
+/**
+ * Chooses a move by alpha-beta search between the player and its nearest
+ * opponent, with iterative deepening until the ai_time_budget_ms() budget
+ * (CLOCK_MONOTONIC) runs out; depth 1 always completes. Moves are made and unmade in place on a private
+ * copy of the state; positions are keyed by incremental Zobrist hashes into a
+ * fixed-size transposition table reused across moves. Leaves are scored by
+ * score difference plus Voronoi territory value within SEARCH_EVAL_RADIUS of
+ * the heads (evaluate_territory()), so their cost does not grow with the board;
+ * the clock is checked before each of them.
+ * Same contract as choose_best_move().
+ * @param move: output array [2] to store the chosen direction vector
+ * @param gs: pointer to the game state
+ * @param sync: pointer to synchronization structures, or NULL if gs is a private snapshot
+ * @param id: player ID
+ * @return: 0 if a valid move is found, -1 if no moves available
+ */
+int choose_best_move_search(int *move, const game_state_t *gs, sync_t *sync, int id);
+
+#endif //SEARCH_H
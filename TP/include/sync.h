@@ -4,17 +4,37 @@
 #include "common.h"
 
 /**
- * Initialize all semaphores in a shared sync_t block.
+ * Initialize all semaphores and lock words in a shared sync_t block.
  * Preconditions: s points to zeroed shared memory from allocate_sync_shm().
  * drawing_signal / not_drawing_signal: handshake master <-> view.
  * accessor_queue_signal: fair queue to serialize access intent.
  * full_access_signal: writer exclusion / blocks while readers present.
  * reader_count_protect_signal: protects reader_count.
  * move_signal[i]: per‑player permit to produce next move.
- * Post: semaphores ready; reader_count = 0.
+ * rw_state / rw_ticket_*: futex reader/writer lock (default build); the three
+ * semaphores above back the lock instead when built with SYNC_SEMAPHORE_RWLOCK.
+ * Post: semaphores ready; reader_count = 0; state_seq = 0; lock free; move_credits = 1.
  * @param s Pointer to shared sync_t structure.
+ * @param policy Fairness of the futex lock (ignored by the semaphore lock).
  */
-void init_sync(sync_t *s);
+void init_sync(sync_t *s, rw_policy_t policy);
+
+/**
+ * Raise the credit window: every move_signal[i] starts with credits permits so a
+ * player may have that many moves in flight. Must be called right after
+ * init_sync(), before any player process starts.
+ * @param s Pointer to shared sync_t structure.
+ * @param credits Window size (1..MAX_MOVE_CREDITS); values <= current are ignored.
+ */
+void set_move_credits(sync_t *s, unsigned int credits);
+
+/**
+ * Parses a fairness policy name ("fifo", "reader" or "writer").
+ * @param name Policy name as given on the command line
+ * @param policy Output policy
+ * @return 0 on success, -1 if the name is unknown
+ */
+int parse_rw_policy(const char *name, rw_policy_t *policy);
 
 /**
  * Destroy (sem_destroy) all semaphores in sync_t. Does not unmap/unlink shared memory.
@@ -24,28 +44,76 @@ void init_sync(sync_t *s);
 void destroy_sync(sync_t *s);
 
 /**
- * Acquire read lock. Multiple readers allowed; first reader acquires full_access_signal.
- * Fairness ensured via accessor_queue_signal.
+ * Acquire read lock. Multiple readers allowed.
+ * Futex lock: one CAS on rw_state when no writer holds it (plus a ticket under FIFO).
+ * Semaphore lock: first reader acquires full_access_signal; fairness via accessor_queue_signal.
  * @param s Pointer to shared sync_t structure.
  */
 void reader_lock(sync_t *s);
 
 /**
- * Release read lock. Last reader releases full_access_signal.
+ * Release read lock. The last reader wakes sleepers (futex) or releases full_access_signal.
  * @param s Pointer to shared sync_t structure.
  */
 void reader_unlock(sync_t *s);
 
 /**
- * Acquire write lock: take accessor_queue_signal then full_access_signal for exclusive access.
+ * Acquire write lock for exclusive access (futex: set RW_WRITER once readers drain;
+ * semaphores: take accessor_queue_signal then full_access_signal). The futex
+ * writer takes those two semaphores as well, so readers following the original
+ * semaphore protocol (binaries not built from this tree) are still excluded.
+ * Makes state_seq odd so lock-free snapshot readers retry until writer_unlock().
  * @param s Pointer to shared sync_t structure.
  */
 void writer_lock(sync_t *s);
 
 /**
  * Release write lock in reverse order, allowing next waiter (reader or writer).
+ * Makes state_seq even again, publishing the commit to snapshot readers.
  * @param s Pointer to shared sync_t structure.
  */
 void writer_unlock(sync_t *s);
 
+/**
+ * Async view (-a), master side: announce that the game state changed. Never
+ * blocks; the futex wake is only issued if the view is sleeping.
+ * @param s Pointer to shared sync_t structure.
+ */
+void publish_view_frame(sync_t *s);
+
+/**
+ * Async view (-a), view side: sleep until the master published a state newer
+ * than seen. Rounds published meanwhile are coalesced into one frame.
+ * @param s Pointer to shared sync_t structure.
+ * @param seen Generation of the last frame drawn (0 before the first one)
+ * @return Current generation, different from seen
+ */
+unsigned int wait_view_frame(sync_t *s, unsigned int seen);
+
+/**
+ * Block while *addr == expected (process-shared futex, so addr may live in shm).
+ * Returns immediately if the value already differs.
+ * @param addr Futex word
+ * @param expected Value observed by the caller before deciding to sleep
+ * @param timeout_ms Maximum wait in milliseconds, -1 to wait forever
+ * @return 0 when woken or the value changed, -1 on timeout/interrupt (errno set)
+ */
+int futex_wait(unsigned int *addr, unsigned int expected, int timeout_ms);
+
+/**
+ * Wake up to count waiters blocked in futex_wait() on addr.
+ * @param addr Futex word
+ * @param count Maximum number of waiters to wake (INT_MAX for all)
+ */
+void futex_wake(unsigned int *addr, int count);
+
+/**
+ * Spin briefly until *addr != value, adapting the spin budget to how often
+ * spinning alone succeeded. Never sleeps.
+ * @param addr Word to watch
+ * @param value Value to wait away from
+ * @return true if the value changed while spinning, false if the budget ran out
+ */
+bool spin_while_equal(const unsigned int *addr, unsigned int value);
+
 #endif //SYNC_H
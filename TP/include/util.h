@@ -2,6 +2,7 @@
 #define UTIL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 #include "common.h"
 
@@ -50,13 +51,67 @@ bool is_free_cell(int cell_value);
 bool in_bounds(const game_state_t *gs, int x, int y);
 
 /**
- * Safely gets a cell value from the game board
+ * First cell of the v2 board (int8_t cells after the board header)
+ * @param gs: pointer to a v2 game state
+ * @return: pointer to cell (0,0)
+ */
+static inline int8_t *board_cells_v2(const game_state_t *gs) {
+    return (int8_t *)((char *)(void *)gs->board + sizeof(board_header_t));
+}
+
+/**
+ * Gets a cell value from the game board, whatever its layout
  * @param gs: pointer to game state
- * @param x: x coordinate
- * @param y: y coordinate
+ * @param x: x coordinate (in bounds)
+ * @param y: y coordinate (in bounds)
  * @return: cell value at the given coordinates
  */
-int get_cell(const game_state_t *gs, int x, int y);
+static inline int get_cell(const game_state_t *gs, int x, int y) {
+    size_t idx = (size_t)y * gs->width + (size_t)x;
+    if (board_layout(gs) == BOARD_LAYOUT_V2) {
+        return board_cells_v2(gs)[idx];
+    }
+    return gs->board[idx];
+}
+
+/**
+ * Sets a cell value on the game board, whatever its layout
+ * @param gs: pointer to game state (writable)
+ * @param x: x coordinate (in bounds)
+ * @param y: y coordinate (in bounds)
+ * @param value: free value (1..9) or owner (0..-8)
+ */
+static inline void set_cell(game_state_t *gs, int x, int y, int value) {
+    size_t idx = (size_t)y * gs->width + (size_t)x;
+    if (board_layout(gs) == BOARD_LAYOUT_V2) {
+        board_cells_v2(gs)[idx] = (int8_t)value;
+    } else {
+        gs->board[idx] = value;
+    }
+}
+
+/**
+ * Raw bytes of one board row, e.g. to memcmp() two boards of the same layout
+ * @param gs: pointer to game state
+ * @param y: row
+ * @return: pointer to the first cell of the row
+ */
+static inline const void *board_row(const game_state_t *gs, int y) {
+    size_t idx = (size_t)y * gs->width;
+    if (board_layout(gs) == BOARD_LAYOUT_V2) {
+        return board_cells_v2(gs) + idx;
+    }
+    return gs->board + idx;
+}
+
+/**
+ * Size of one cell in bytes (sizeof(int) for v1, 1 for v2)
+ * @param gs: pointer to game state
+ * @return: cell size
+ */
+static inline size_t board_cell_size(const game_state_t *gs) {
+    return (board_layout(gs) == BOARD_LAYOUT_V2) ? sizeof(int8_t) : sizeof(int);
+}
 
 /**
  * Counts the number of free neighboring cells around a position
@@ -77,6 +132,50 @@ int count_free_neighbors(const game_state_t *gs, int x, int y);
  */
 bool is_valid_move(int player_pos, int new_x, int new_y, game_state_t* gs);
 
+#define FREE_NEIGHBOR_SCRATCH(width) (6 * (size_t)(width) + 6) // scratch bytes of free_neighbor_map()
+
+/**
+ * Free-neighbour counts (0-8) of every cell in rows [y0, y1) in one pass,
+ * vectorised over whole rows (AVX2 or SSE2, picked at runtime; scalar without
+ * them or when built with NO_SIMD). Rows outside the board are clamped.
+ * @param gs: pointer to game state (the caller holds whatever lock it needs)
+ * @param counts: output, width bytes per row; row y starts at counts[(y - y0) * width]
+ * @param scratch: FREE_NEIGHBOR_SCRATCH(gs->width) bytes for the rolling rows, reusable across calls
+ * @param y0: first row (e.g. 0, or the top of a dirty band)
+ * @param y1: one past the last row (e.g. height)
+ */
+void free_neighbor_map(const game_state_t *gs, uint8_t *counts, uint8_t *scratch, int y0, int y1);
+
+#define BOARD_DELTA_MAX 64  // cells taken per update beyond which board_delta() gives up
+
+/**
+ * What a board-derived cache (bitboard, component labels) last saw of a game:
+ * enough to work out the cells taken since then without reading the board.
+ */
+typedef struct {
+    const game_state_t *gs;             // state last synced (NULL: none yet)
+    unsigned int num_players;
+    unsigned int valids[MAX_PLAYERS];   // per-player valid moves at the last sync
+    unsigned short x[MAX_PLAYERS], y[MAX_PLAYERS];
+} board_delta_t;
+
+/**
+ * Cells taken since the previous call: for each player, the trail of cells
+ * holding -p that was_free() still reports as free, walked from its previous
+ * head. The trail must account for exactly the player's new valid moves, so
+ * several moves per player (-k) stay incremental. Records gs as synced.
+ * @param delta: tracker (zeroed before the first call)
+ * @param gs: game state; the same pointer on every call keeps updates incremental
+ * @param was_free: whether the caller's cache still has (x, y) as a free cell
+ * @param ctx: passed to was_free
+ * @param cells: output, cell indices (y * width + x), player by player
+ * @param max: capacity of cells
+ * @return: number of cells, or -1 if the caller must rebuild from gs (first
+ *          call, new game, more than max cells, or a state it cannot explain)
+ */
+int board_delta(board_delta_t *delta, const game_state_t *gs, bool (*was_free)(const void *ctx, int x, int y),
+                const void *ctx, int *cells, int max);
+
 /**
  * Calculates the time difference in milliseconds between two timespecs
  * @param start: starting timespec
@@ -85,4 +184,16 @@ bool is_valid_move(int player_pos, int new_x, int new_y, game_state_t* gs);
  */
 long calculate_time_diff_ms(struct timespec start, struct timespec end);
 
+/**
+ * Current CLOCK_MONOTONIC time in milliseconds (unaffected by wall-clock changes)
+ * @return: milliseconds since an arbitrary fixed point
+ */
+long long monotonic_ms(void);
+
+/**
+ * Current CLOCK_MONOTONIC time in microseconds, for latencies below a millisecond
+ * @return: microseconds since the same fixed point as monotonic_ms()
+ */
+long long monotonic_us(void);
+
 #endif //UTIL_H
@@ -1,9 +1,23 @@
 #include "common.h"
+#include "ai.h"
 #include "util.h"
 #include "sync.h"
+#include "bitboard.h"
+#include "components.h"
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// sync == NULL means gs is a private snapshot and needs no locking
+static void read_begin(sync_t *sync) {
+    if (sync != NULL) reader_lock(sync);
+}
+
+static void read_end(sync_t *sync) {
+    if (sync != NULL) reader_unlock(sync);
+}
+
 static int min_chebyshev_to_opponent(const game_state_t *gs, int me, int x, int y) {
     int best = 999999;
     for (unsigned int i = 0; i < gs->num_players; ++i) {
@@ -18,78 +32,307 @@ static int min_chebyshev_to_opponent(const game_state_t *gs, int me, int x, int
     return (best == 999999) ? 99 : best;
 }
 
-typedef struct { int x, y, d; } qnode_t;
+// Scratch sized to the board, one per thread: player processes build it at
+// startup (ai_init), in-process strategies on first use from each pool thread.
+typedef struct {
+    unsigned short width, height;
+    bitboard_t *bb;
+    uint32_t *stamp;        // stamp[i] == generation: cell i reached in the current pass
+    uint32_t generation;    // bumped per pass instead of clearing stamp
+    int *dist;              // BFS distance of reached cells
+    signed char *owner;     // nearest player of reached cells, or VORONOI_TIE
+    uint8_t *seeds;         // cells owned by the searching player: bitmask of its closest start cells
+    int *queue;             // flat FIFO of cell indices, one slot per cell
+    components_t *comps;    // free-cell components, updated across turns
+} ai_workspace_t;
+
+#define VORONOI_TIE (-1)
+
+static void workspace_release(ai_workspace_t *ws) {
+    bitboard_destroy(ws->bb);
+    components_destroy(ws->comps);
+    free(ws->stamp);
+    free(ws->dist);
+    free(ws->owner);
+    free(ws->seeds);
+    free(ws->queue);
+    ws->bb = NULL;
+    ws->comps = NULL;
+    ws->stamp = NULL;
+    ws->dist = NULL;
+    ws->owner = NULL;
+    ws->seeds = NULL;
+    ws->queue = NULL;
+}
+
+static pthread_key_t workspace_key;
+static pthread_once_t workspace_once = PTHREAD_ONCE_INIT;
+
+static void workspace_free(void *arg) {
+    ai_workspace_t *ws = arg;
+    workspace_release(ws);
+    free(ws);
+}
 
-static int hash_idx(int x, int y, int mask) {
-    unsigned int hx = (unsigned int)x * 73856093u;
-    unsigned int hy = (unsigned int)y * 19349663u;
-    return (int)((hx ^ hy) & (unsigned int)mask);
+static void workspace_key_init(void) {
+    if (pthread_key_create(&workspace_key, workspace_free) != 0) {
+        perror("pthread_key_create");
+    }
 }
 
-static int was_visited_put(int *vx, int *vy, unsigned char *used, int ht_mask, int x, int y) {
-    int h = hash_idx(x, y, ht_mask);
-    for (int t = 0; t <= ht_mask; ++t) {
-        int i = (h + t) & ht_mask;
-        if (!used[i]) {
-            used[i] = 1; vx[i] = x; vy[i] = y; return 0;
+static ai_workspace_t *workspace_get(unsigned short width, unsigned short height) {
+    pthread_once(&workspace_once, workspace_key_init);
+    ai_workspace_t *ws = pthread_getspecific(workspace_key);
+    if (ws != NULL && ws->bb != NULL && ws->width == width && ws->height == height) {
+        return ws;
+    }
+    if (ws == NULL) {
+        ws = calloc(1, sizeof(*ws));
+        if (ws == NULL) {
+            perror("calloc AI workspace");
+            return NULL;
         }
-        if (vx[i] == x && vy[i] == y) {
-            return 1;
+        if (pthread_setspecific(workspace_key, ws) != 0) {
+            free(ws);
+            return NULL;
         }
     }
-    return 1;
+    workspace_release(ws);
+    size_t cells = (size_t)width * height;
+    ws->bb = bitboard_create(width, height);
+    ws->comps = components_create(width, height);
+    ws->stamp = calloc(cells, sizeof(uint32_t));
+    ws->dist = malloc(cells * sizeof(int));
+    ws->owner = malloc(cells);
+    ws->seeds = malloc(cells);
+    ws->queue = malloc(cells * sizeof(int));
+    ws->generation = 0;
+    ws->width = width;
+    ws->height = height;
+    if (ws->bb == NULL || ws->comps == NULL || ws->stamp == NULL || ws->dist == NULL || ws->owner == NULL || ws->seeds == NULL || ws->queue == NULL) {
+        perror("malloc AI workspace");
+        workspace_release(ws);
+        return NULL;
+    }
+    return ws;
 }
 
-static int territory_potential(const game_state_t *gs, int sx, int sy, int max_depth, int max_nodes, int *total_value) {
-    if (!in_bounds(gs, sx, sy) || !is_free_cell(get_cell(gs, sx, sy))) {
-        if (total_value) *total_value = 0;
-        return 0;
-    }
+int ai_init(unsigned short width, unsigned short height) {
+    return (workspace_get(width, height) != NULL) ? 0 : -1;
+}
 
-    enum { QMAX = 1024, HT = 2048 };
-    qnode_t q[QMAX];
-    int head = 0, tail = 0, size = 0;
+#define VORONOI_MAX_STARTS 8
 
-    int vx[HT], vy[HT]; unsigned char used[HT];
-    memset(used, 0, sizeof(used));
+typedef struct {
+    int cells[MAX_PLAYERS];     // free cells the player reaches strictly before any other
+    int value[MAX_PLAYERS];     // sum of their values
+    int start_cells[VORONOI_MAX_STARTS];  // player me's cells closest to each of its start cells
+    int start_value[VORONOI_MAX_STARTS];
+} voronoi_t;
 
-    (void)was_visited_put(vx, vy, used, HT - 1, sx, sy);
-    q[tail] = (qnode_t){ sx, sy, 0 }; tail = (tail + 1) % QMAX; size++;
+/**
+ * Multi-source BFS from player heads at once: each free cell goes to the
+ * player that reaches it first in king moves, ties go to nobody. Player me
+ * starts from all of its nstarts start cells (e.g. its head, or every move it
+ * can make) at once; opponents start from their heads in gs, and only those in
+ * the rivals bitmask take part. Each of me's cells is also credited to the start
+ * cells it is closest to, so one pass scores every candidate move. Cells more
+ * than radius moves from every start are left out (radius 0: no limit).
+ */
+static void voronoi(ai_workspace_t *ws, const game_state_t *gs, int me, const int *starts, int nstarts,
+                    unsigned int rivals, int radius, voronoi_t *out) {
+    int width = gs->width, height = gs->height;
+    if (++ws->generation == 0) {
+        memset(ws->stamp, 0, (size_t)width * height * sizeof(uint32_t));
+        ws->generation = 1;
+    }
+    uint32_t gen = ws->generation;
+    memset(out, 0, sizeof(*out));
 
-    int visited = 0, expanded = 0;
-    int value_sum = 0;
+    size_t head = 0, tail = 0;
+    for (int k = 0; k < nstarts; k++) {
+        int i = starts[k];
+        ws->stamp[i] = gen;
+        ws->dist[i] = 0;
+        ws->owner[i] = (signed char)me;
+        ws->seeds[i] = (uint8_t)(1u << k);
+        ws->queue[tail++] = i;
+    }
+    for (unsigned int p = 0; p < gs->num_players; p++) {
+        if ((int)p == me || !(rivals & (1u << p))) continue;
+        int i = gs->players[p].y * width + gs->players[p].x;
+        if (ws->stamp[i] == gen) continue;  // two heads on one cell: keep the first
+        ws->stamp[i] = gen;
+        ws->dist[i] = 0;
+        ws->owner[i] = (signed char)p;
+        ws->queue[tail++] = i;
+    }
 
-    while (size > 0 && expanded < max_nodes) {
-        qnode_t cur = q[head]; head = (head + 1) % QMAX; size--;
-        visited++;
-        
-        int cell_value = get_cell(gs, cur.x, cur.y);
-        if (is_free_cell(cell_value)) {
-            value_sum += cell_value;
+    while (head < tail) {
+        int i = ws->queue[head++];
+        int x = i % width, y = i / width;
+        int owner = ws->owner[i];   // final: every claim at this distance was made before i was dequeued
+        if (ws->dist[i] > 0 && owner != VORONOI_TIE) {
+            int v = get_cell(gs, x, y);
+            out->cells[owner]++;
+            out->value[owner] += v;
+            for (unsigned int m = (owner == me) ? ws->seeds[i] : 0; m != 0; m &= m - 1) {
+                int k = __builtin_ctz(m);
+                out->start_cells[k]++;
+                out->start_value[k] += v;
+            }
         }
-
-        if (cur.d >= max_depth) continue;
-
+        int nd = ws->dist[i] + 1;
+        if (radius > 0 && nd > radius) continue;
         for (int k = 0; k < 8; ++k) {
-            int nx = cur.x + DIRS[k][0];
-            int ny = cur.y + DIRS[k][1];
-            if (!in_bounds(gs, nx, ny)) continue;
-            if (!is_free_cell(get_cell(gs, nx, ny))) continue;
-            if (was_visited_put(vx, vy, used, HT - 1, nx, ny)) continue;
-            if (size < QMAX - 1) {
-                q[tail] = (qnode_t){ nx, ny, cur.d + 1 };
-                tail = (tail + 1) % QMAX; size++;
+            int nx = x + DIRS[k][0];
+            int ny = y + DIRS[k][1];
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+            int j = ny * width + nx;
+            if (ws->stamp[j] == gen) {
+                if (ws->dist[j] != nd) continue;
+                if (ws->owner[j] != owner) {
+                    ws->owner[j] = VORONOI_TIE;
+                } else if (owner == me) {
+                    ws->seeds[j] |= ws->seeds[i];
+                }
+                continue;
             }
-            expanded++;
-            if (expanded >= max_nodes) break;
+            if (!is_free_cell(get_cell(gs, nx, ny))) continue;
+            ws->stamp[j] = gen;
+            ws->dist[j] = nd;
+            ws->owner[j] = (signed char)owner;
+            ws->seeds[j] = ws->seeds[i];
+            ws->queue[tail++] = j;
         }
     }
-    
-    if (total_value) *total_value = value_sum;
+}
+
+int evaluate_territory(const game_state_t *gs, int id, unsigned int rivals, int radius, int *cells, int *value) {
+    ai_workspace_t *ws = workspace_get(gs->width, gs->height);
+    if (ws == NULL) {
+        return -1;
+    }
+    voronoi_t regions;
+    int start = gs->players[id].y * gs->width + gs->players[id].x;
+    voronoi(ws, gs, id, &start, 1, rivals, radius, &regions);
+    memcpy(cells, regions.cells, sizeof(regions.cells));
+    memcpy(value, regions.value, sizeof(regions.value));
+    return 0;
+}
+
+// Cells reachable from (sx, sy) within max_depth moves (stopping past max_nodes), and their value
+static int territory_potential(bitboard_t *bb, int sx, int sy, int max_depth, int max_nodes, int *total_value) {
+    int visited = bitboard_flood(bb, sx, sy, max_depth, max_nodes, NULL);
+    if (total_value) *total_value = (visited > 0) ? bitboard_value(bb, bb->region, &bb->band) : 0;
     return visited;
 }
 
 int choose_best_move(int *move, const game_state_t *gs, sync_t *sync, int id) {
+    const float W_REWARD       = 0.10f;  // Immediate cell value
+    const float W_REGION       = 0.40f;  // Cells reached before any opponent
+    const float W_REGION_VAL   = 0.50f;  // Value of those cells
+    const float MAX_CELL_VALUE = 9.0f;
+    const float MAX_REGION     = (float)gs->width * gs->height;
+
+    ai_workspace_t *ws = workspace_get(gs->width, gs->height);
+    if (ws == NULL) {
+        return -1;
+    }
+
+    read_begin(sync);
+
+    int x = gs->players[id].x;
+    int y = gs->players[id].y;
+
+    // Opponents whose head touches none of the components around us cannot
+    // contest any cell we can reach: leave them out of the BFS.
+    components_update(ws->comps, gs);
+    int mine[8], nmine = 0, candidates = 0, only_dir = -1;
+    for (int d = 0; d < 8; ++d) {
+        int nx = x + DIRS[d][0];
+        int ny = y + DIRS[d][1];
+        if (!in_bounds(gs, nx, ny)) continue;
+        int label = components_label(ws->comps, nx, ny);
+        if (label == COMPONENT_NONE) continue;
+        candidates++;
+        only_dir = d;
+        bool seen = false;
+        for (int i = 0; i < nmine; i++) seen = seen || mine[i] == label;
+        if (!seen) mine[nmine++] = label;
+    }
+    unsigned int rivals = 0;
+    for (unsigned int p = 0; p < gs->num_players; p++) {
+        if ((int)p == id || gs->players[p].blocked) continue;
+        for (int k = 0; k < 8 && !(rivals & (1u << p)); ++k) {
+            int ox = gs->players[p].x + DIRS[k][0];
+            int oy = gs->players[p].y + DIRS[k][1];
+            if (!in_bounds(gs, ox, oy)) continue;
+            int label = components_label(ws->comps, ox, oy);
+            for (int i = 0; i < nmine; i++) {
+                if (label == mine[i]) rivals |= 1u << p;
+            }
+        }
+    }
+    if (candidates == 1 && rivals == 0) {
+        // Alone in our region with a single way forward: nothing to compare
+        read_end(sync);
+        move[0] = DIRS[only_dir][0];
+        move[1] = DIRS[only_dir][1];
+        return 0;
+    }
+
+    // One pass from every candidate cell at once: each cell we reach first is
+    // credited to the candidates it is closest to
+    int starts[8], start_dir[8], nstarts = 0;
+    for (int d = 0; d < 8; ++d) {
+        int nx = x + DIRS[d][0];
+        int ny = y + DIRS[d][1];
+        if (!in_bounds(gs, nx, ny) || !is_free_cell(get_cell(gs, nx, ny))) continue;
+        start_dir[nstarts] = d;
+        starts[nstarts++] = ny * gs->width + nx;
+    }
+    voronoi_t regions;
+    if (rivals == 0) {
+        // Nobody else in our components: a move gets the rest of its component
+        const components_t *comps = ws->comps;
+        for (int k = 0; k < nstarts; ++k) {
+            int label = comps->label[starts[k]];
+            regions.start_cells[k] = comps->size[label] - 1;
+            regions.start_value[k] = comps->sum[label] - comps->value[starts[k]];
+        }
+    } else {
+        voronoi(ws, gs, id, starts, nstarts, rivals, 0, &regions);
+    }
+
+    int best_dir = -1;
+    float best_score = -1e9f;
+
+    for (int k = 0; k < nstarts; ++k) {
+        int d = start_dir[k];
+        int v = get_cell(gs, x + DIRS[d][0], y + DIRS[d][1]);
+        float score = W_REWARD * ((float)v / MAX_CELL_VALUE)
+                    + W_REGION * ((float)regions.start_cells[k] / MAX_REGION)
+                    + W_REGION_VAL * ((float)regions.start_value[k] / (MAX_REGION * MAX_CELL_VALUE));
+
+        if (score > best_score) {
+            best_score = score;
+            best_dir = d;
+        }
+    }
+
+    read_end(sync);
+
+    if (best_dir < 0) {
+        return -1;
+    }
+
+    move[0] = DIRS[best_dir][0];
+    move[1] = DIRS[best_dir][1];
+    return 0;
+}
+
+int choose_best_move_flood(int *move, const game_state_t *gs, sync_t *sync, int id) {
     // Normalized weights that sum to 1.0
     const float W_REWARD        = 0.15f;  // Immediate cell value
     const float W_TERRITORY     = 0.25f;  // Territory potential 
@@ -102,7 +345,14 @@ int choose_best_move(int *move, const game_state_t *gs, sync_t *sync, int id) {
     const float MAX_TERRITORY_VALUE = MAX_TERRITORY_NODES * MAX_CELL_VALUE; // All cells with max value
     const float MIN_OPPONENT_DIST = 1.0f;
 
-    reader_lock(sync);
+    ai_workspace_t *ws = workspace_get(gs->width, gs->height);
+    if (ws == NULL) {
+        return -1;
+    }
+    bitboard_t *bb = ws->bb;
+
+    read_begin(sync);
+    bitboard_sync(bb, gs);
 
     int x = gs->players[id].x;
     int y = gs->players[id].y;
@@ -123,7 +373,7 @@ int choose_best_move(int *move, const game_state_t *gs, sync_t *sync, int id) {
         score += W_REWARD * ((float)v / MAX_CELL_VALUE);
 
         int territory_value = 0;
-        int pot = territory_potential(gs, nx, ny, 20, 400, &territory_value);
+        int pot = territory_potential(bb, nx, ny, 20, 400, &territory_value);
         score += W_TERRITORY * ((float)pot / MAX_TERRITORY_NODES);
         
         // Normalize territory value to [0, W_TERRITORY_VAL]
@@ -144,20 +394,19 @@ int choose_best_move(int *move, const game_state_t *gs, sync_t *sync, int id) {
         }
     }
 
+    read_end(sync);
+
     if (best_dir < 0) {
-        reader_unlock(sync);
         return -1;
     }
 
     move[0] = DIRS[best_dir][0];
     move[1] = DIRS[best_dir][1];
-
-    reader_unlock(sync);
     return 0;
 }
 
 int choose_best_move_naive(int *move, const game_state_t *gs, sync_t *sync, int id) {
-    reader_lock(sync);
+    read_begin(sync);
     int x = gs->players[id].x;
     int y = gs->players[id].y;
 
@@ -167,10 +416,51 @@ int choose_best_move_naive(int *move, const game_state_t *gs, sync_t *sync, int
         if (in_bounds(gs, nx, ny) && is_free_cell(get_cell(gs, nx, ny))){
             move[0] = DIRS[k][0];
             move[1] = DIRS[k][1];
-            reader_unlock(sync);
+            read_end(sync);
             return 0;
         }
     }
-    reader_unlock(sync);
+    read_end(sync);
     return -1;
 }
+
+int ai_nearest_opponent(const game_state_t *gs, int id) {
+    int best = -1, best_d = 0;
+    for (unsigned int p = 0; p < gs->num_players; p++) {
+        if ((int)p == id || gs->players[p].blocked) continue;
+        int dx = abs(gs->players[p].x - gs->players[id].x);
+        int dy = abs(gs->players[p].y - gs->players[id].y);
+        int d = (dx > dy) ? dx : dy;
+        if (best < 0 || d < best_d) {
+            best_d = d;
+            best = (int)p;
+        }
+    }
+    return best;
+}
+
+long long ai_time_budget_ms(void) {
+    const char *env = getenv(AI_TIME_ENV);
+    long long ms = (env != NULL) ? atoll(env) : 0;
+    return (ms > 0) ? ms : AI_DEFAULT_TIME_MS;
+}
+
+int plan_moves(unsigned char *dirs, int max_moves, game_state_t *gs, int id, ai_strategy_t strategy) {
+    int planned = 0;
+    int move[2];
+    while (planned < max_moves && strategy(move, gs, NULL, id) == 0) {
+        unsigned char dir = direction_to_char(move);
+        int nx = gs->players[id].x + move[0];
+        int ny = gs->players[id].y + move[1];
+
+        // Apply the move to the private snapshot so the next step plans from there
+        gs->players[id].score += get_cell(gs, nx, ny);
+        gs->players[id].valids++;
+        gs->players[id].x = (unsigned short)nx;
+        gs->players[id].y = (unsigned short)ny;
+        set_cell(gs, nx, ny, -id);
+
+        dirs[planned++] = dir;
+    }
+    return planned;
+}
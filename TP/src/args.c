@@ -1,13 +1,15 @@
 #include "args.h"
+#include "sync.h"
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 int parse_args(int argc, char **argv, args_t *args) {
     int player_count = 0;
     int opt;
 
-    while ((opt = getopt(argc, argv, "w:h:d:t:s:v:p:")) != -1) {
+    while ((opt = getopt(argc, argv, "w:h:d:t:T:BM:s:v:ae:m:k:n:rj:b:F:o:S:p:")) != -1) {
         switch (opt) {
         case 'w':
             args->width = (unsigned short)atoi(optarg);
@@ -21,12 +23,91 @@ int parse_args(int argc, char **argv, args_t *args) {
         case 't':
             args->timeout = atoi(optarg);
             break;
+        case 'T':
+            args->think_ms = atoi(optarg);
+            if (args->think_ms < 0) {
+                fprintf(stderr, "Error: -T no puede ser negativo\n");
+                return -1;
+            }
+            break;
+        case 'B':
+            args->overrun_blocks = true;
+            break;
+        case 'M':
+            if (atoi(optarg) < 0) {
+                fprintf(stderr, "Error: -M no puede ser negativo\n");
+                return -1;
+            }
+            args->max_moves = (unsigned int)atoi(optarg);
+            break;
         case 's':
             args->seed = (unsigned int)atoi(optarg);
             break;
         case 'v':
             args->view_path = optarg;
             break;
+        case 'a':
+            args->async_view = true;
+            break;
+        case 'e':
+            if (parse_event_backend(optarg, &args->backend) == -1) {
+                fprintf(stderr, "Error: backend desconocido '%s' (epoll | io_uring)\n", optarg);
+                return -1;
+            }
+            break;
+        case 'm':
+            if (strcmp(optarg, "pipe") == 0) {
+                args->transport = TRANSPORT_PIPE;
+            } else if (strcmp(optarg, "ring") == 0) {
+                args->transport = TRANSPORT_RING;
+            } else {
+                fprintf(stderr, "Error: transporte desconocido '%s' (pipe | ring)\n", optarg);
+                return -1;
+            }
+            break;
+        case 'k':
+            args->credits = (unsigned int)atoi(optarg);
+            if (args->credits < 1 || args->credits > MAX_MOVE_CREDITS) {
+                fprintf(stderr, "Error: -k debe estar entre 1 y %d\n", MAX_MOVE_CREDITS);
+                return -1;
+            }
+            break;
+        case 'n':
+            if (atoi(optarg) < 1) {
+                fprintf(stderr, "Error: -n debe ser al menos 1\n");
+                return -1;
+            }
+            args->games = (unsigned int)atoi(optarg);
+            break;
+        case 'r':
+            args->reuse = true;
+            break;
+        case 'j':
+            if (atoi(optarg) < 1 || atoi(optarg) > MAX_INSTANCES) {
+                fprintf(stderr, "Error: -j debe estar entre 1 y %d\n", MAX_INSTANCES);
+                return -1;
+            }
+            args->instances = (unsigned int)atoi(optarg);
+            break;
+        case 'b':
+            args->layout = atoi(optarg);
+            if (args->layout != BOARD_LAYOUT_V1 && args->layout != BOARD_LAYOUT_V2) {
+                fprintf(stderr, "Error: -b debe ser %d o %d\n", BOARD_LAYOUT_V1, BOARD_LAYOUT_V2);
+                return -1;
+            }
+            break;
+        case 'F':
+            if (parse_rw_policy(optarg, &args->rw_policy) == -1) {
+                fprintf(stderr, "Error: política desconocida '%s' (fifo | reader | writer)\n", optarg);
+                return -1;
+            }
+            break;
+        case 'o':
+            args->record_path = optarg;
+            break;
+        case 'S':
+            args->stats_path = optarg;
+            break;
         case 'p':
             args->player_paths[player_count++] = optarg;
             while (optind < argc && argv[optind][0] != '-') {
@@ -38,8 +119,8 @@ int parse_args(int argc, char **argv, args_t *args) {
             }
             break;
         default:
-            fprintf(stderr, "Uso: %s [-w width] [-h height] [-d delay] [-t timeout] "
-                            "[-s seed] [-v view] -p player1 [player2 ...]\n", argv[0]);
+            fprintf(stderr, "Uso: %s [-w width] [-h height] [-d delay] [-t timeout] [-T think_ms] [-B] [-M moves] "
+                            "[-s seed] [-v view] [-a] [-e epoll|io_uring] [-m pipe|ring] [-k credits] [-n games] [-r] [-j games] [-b 1|2] [-F fifo|reader|writer] [-o file] [-S file] -p player1 [player2 ...]\n", argv[0]);
             return -1;
         }
     }
@@ -49,5 +130,15 @@ int parse_args(int argc, char **argv, args_t *args) {
         return -1;
     }
 
+    if (args->instances > 1 && args->view_path != NULL) {
+        fprintf(stderr, "Error: -v no es compatible con -j\n");
+        return -1;
+    }
+
+    if (args->instances > 1 && args->record_path != NULL) {
+        fprintf(stderr, "Error: -o no es compatible con -j\n");
+        return -1;
+    }
+
     return player_count;
 }
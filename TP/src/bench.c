@@ -0,0 +1,534 @@
+#define _GNU_SOURCE
+#include "bench.h"
+#include "ai.h"
+#include "player.h"
+#include "util.h"
+
+#define MAX_INT_SIZE 12
+#define BENCH_LINE_LEN 512
+#define BENCH_MAX_ROWS 256
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// The matrix: small boards for the per-move overhead, large ones for
+// throughput and memory, and every strategy on a board it finishes quickly.
+// The default strategy, flood and search also run on large boards, where a
+// move whose cost grows with the board overruns BENCH_THINK_DEADLINE_MS; their
+// games are cut after max_moves moves.
+static const bench_case_t bench_cases[] = {
+    { 10,   10,   1, "voronoi", 0   },
+    { 10,   10,   2, "naive",   0   },
+    { 10,   10,   9, "voronoi", 0   },
+    { 20,   20,   2, "search",  0   },
+    { 20,   20,   2, "mcts",    0   },
+    { 100,  100,  2, "voronoi", 0   },
+    { 100,  100,  4, "flood",   0   },
+    { 100,  100,  9, "naive",   0   },
+    { 500,  500,  2, "voronoi", 400 },
+    { 500,  500,  4, "flood",   400 },
+    { 500,  500,  2, "search",  400 },
+    { 500,  500,  4, "naive",   0   },
+    { 1000, 1000, 2, "voronoi", 200 },
+    { 1000, 1000, 4, "flood",   200 },
+    { 1000, 1000, 2, "search",  200 },
+    { 2000, 2000, 9, "naive",   0   },
+};
+
+#define BENCH_CASES ((int)(sizeof(bench_cases) / sizeof(bench_cases[0])))
+
+static const char bench_columns[] =
+    "case\tseed\tstatus\tmoves\twall_ms\tmoves_per_s\trtt_p50_us\trtt_p99_us\trss_master_kb\trss_player_kb\n";
+
+int parse_bench_args(int argc, char **argv, bench_args_t *args) {
+    memset(args, 0, sizeof(*args));
+    args->master = "bin/master";
+    args->player = "bin/player";
+    args->tolerance = BENCH_TOLERANCE;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:p:f:o:b:t:")) != -1) {
+        switch (opt) {
+        case 'm':
+            args->master = optarg;
+            break;
+        case 'p':
+            args->player = optarg;
+            break;
+        case 'f':
+            args->filter = optarg;
+            break;
+        case 'o':
+            args->out_path = optarg;
+            break;
+        case 'b':
+            args->baseline_path = optarg;
+            break;
+        case 't':
+            args->tolerance = atof(optarg);
+            if (args->tolerance <= 0) {
+                fprintf(stderr, "Error: -t debe ser mayor a 0\n");
+                return -1;
+            }
+            break;
+        default:
+            fprintf(stderr, "Uso: %s [-m master] [-p player] [-f filtro] [-o resultados.tsv] [-b baseline.tsv] [-t tolerancia]\n",
+                    argv[0]);
+            return -1;
+        }
+    }
+    if (optind != argc) {
+        fprintf(stderr, "Error: argumento inesperado '%s'\n", argv[optind]);
+        return -1;
+    }
+    return 0;
+}
+
+static void case_name(const bench_case_t *bc, char *name, size_t len) {
+    snprintf(name, len, "%ux%u-%dp-%s", bc->width, bc->height, bc->players, bc->strategy);
+}
+
+static pid_t spawn_master(const bench_args_t *args, const bench_case_t *bc, unsigned int seed, const char *stats_path) {
+    char width_s[MAX_INT_SIZE];
+    char height_s[MAX_INT_SIZE];
+    char seed_s[MAX_INT_SIZE];
+    char max_moves_s[MAX_INT_SIZE];
+    snprintf(width_s, sizeof(width_s), "%u", bc->width);
+    snprintf(height_s, sizeof(height_s), "%u", bc->height);
+    snprintf(seed_s, sizeof(seed_s), "%u", seed);
+    snprintf(max_moves_s, sizeof(max_moves_s), "%u", bc->max_moves);
+
+    char *argv[20 + MAX_PLAYERS];
+    int n = 0;
+    argv[n++] = (char *)args->master;
+    argv[n++] = "-w";
+    argv[n++] = width_s;
+    argv[n++] = "-h";
+    argv[n++] = height_s;
+    argv[n++] = "-d";
+    argv[n++] = "0";
+    argv[n++] = "-t";
+    argv[n++] = BENCH_INACTIVITY_S;
+    argv[n++] = "-T";
+    argv[n++] = BENCH_THINK_DEADLINE_MS;
+    argv[n++] = "-M";
+    argv[n++] = max_moves_s;
+    argv[n++] = "-s";
+    argv[n++] = seed_s;
+    argv[n++] = "-S";
+    argv[n++] = (char *)stats_path;
+    argv[n++] = "-p";
+    for (int i = 0; i < bc->players; i++) {
+        argv[n++] = (char *)args->player;
+    }
+    argv[n] = NULL;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork master");
+        return -1;
+    }
+    if (pid == 0) {
+        // The master forwards the CHOMP_* variables to its players
+        setenv(PLAYER_STRATEGY_ENV, bc->strategy, 1);
+        setenv(AI_TIME_ENV, BENCH_THINK_MS, 1);
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd != -1) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+        execv(args->master, argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+// Waits for the master up to BENCH_TIMEOUT_MS; kills it past that
+static bool wait_master(pid_t pid) {
+    long long deadline = monotonic_ms() + BENCH_TIMEOUT_MS;
+    int status;
+    for (;;) {
+        pid_t r = waitpid(pid, &status, WNOHANG);
+        if (r == pid) {
+            return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        if (r == -1 && errno != EINTR) {
+            perror("waitpid master");
+            return false;
+        }
+        if (monotonic_ms() >= deadline) {
+            // SIGTERM lets the master unlink its segments and reap the players
+            kill(pid, SIGTERM);
+            while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {
+            }
+            return false;
+        }
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = BENCH_POLL_MS * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Value of key in a "key=value key=value" line, or NULL
+static const char *stats_field(const char *line, const char *key) {
+    size_t len = strlen(key);
+    for (const char *p = line; (p = strstr(p, key)) != NULL; p += len) {
+        if ((p == line || p[-1] == ' ') && p[len] == '=') {
+            return p + len + 1;
+        }
+    }
+    return NULL;
+}
+
+static bool parse_stats(const char *line, bench_result_t *result) {
+    const char *moves = stats_field(line, "moves");
+    const char *wall = stats_field(line, "wall_ms");
+    const char *speed = stats_field(line, "moves_per_s");
+    const char *p50 = stats_field(line, "rtt_p50_us");
+    const char *p99 = stats_field(line, "rtt_p99_us");
+    const char *overruns = stats_field(line, "overruns");
+    const char *master = stats_field(line, "rss_master_kb");
+    const char *players = stats_field(line, "rss_players_kb");
+    if (moves == NULL || wall == NULL || speed == NULL || p50 == NULL || p99 == NULL || overruns == NULL ||
+        master == NULL || players == NULL) {
+        return false;
+    }
+    result->moves = (unsigned int)strtoul(moves, NULL, 10);
+    result->wall_ms = strtod(wall, NULL);
+    result->moves_per_s = strtod(speed, NULL);
+    result->rtt_p50_us = (unsigned int)strtoul(p50, NULL, 10);
+    result->rtt_p99_us = (unsigned int)strtoul(p99, NULL, 10);
+    result->rss_master_kb = strtol(master, NULL, 10);
+    // Comma-separated, one per player: the largest is the one that matters
+    result->rss_player_kb = 0;
+    char *end;
+    for (const char *p = players;; p = end + 1) {
+        long kb = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        if (kb > result->rss_player_kb) {
+            result->rss_player_kb = kb;
+        }
+        if (*end != ',') {
+            break;
+        }
+    }
+    // A move past the think deadline: something costs more than it should on this board
+    unsigned long late = strtoul(overruns, NULL, 10);
+    if (late > 0) {
+        fprintf(stderr, "%s semilla %u: %lu movidas pasaron el plazo de %s ms\n", result->name, result->seed, late,
+                BENCH_THINK_DEADLINE_MS);
+        return false;
+    }
+    return true;
+}
+
+void run_bench_case(const bench_args_t *args, const bench_case_t *bc, unsigned int seed, bench_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    case_name(bc, result->name, sizeof(result->name));
+    result->seed = seed;
+
+    char stats_path[] = "/tmp/chomp-bench-XXXXXX";
+    int fd = mkstemp(stats_path);
+    if (fd == -1) {
+        perror("mkstemp");
+        return;
+    }
+    close(fd);
+
+    pid_t pid = spawn_master(args, bc, seed, stats_path);
+    if (pid != -1 && wait_master(pid)) {
+        FILE *f = fopen(stats_path, "r");
+        if (f == NULL) {
+            perror("fopen stats");
+        } else {
+            char line[BENCH_LINE_LEN];
+            result->ok = fgets(line, sizeof(line), f) != NULL && parse_stats(line, result);
+            fclose(f);
+        }
+    }
+    unlink(stats_path);
+}
+
+static void print_result(FILE *f, const bench_result_t *r) {
+    fprintf(f, "%s\t%u\t%s\t%u\t%.3f\t%.0f\t%u\t%u\t%ld\t%ld\n", r->name, r->seed, r->ok ? "ok" : "fail", r->moves,
+            r->wall_ms, r->moves_per_s, r->rtt_p50_us, r->rtt_p99_us, r->rss_master_kb, r->rss_player_kb);
+}
+
+static bool parse_result(char *line, bench_result_t *r) {
+    char status[8];
+    memset(r, 0, sizeof(*r));
+    if (sscanf(line, "%47s %u %7s %u %lf %lf %u %u %ld %ld", r->name, &r->seed, status, &r->moves, &r->wall_ms,
+               &r->moves_per_s, &r->rtt_p50_us, &r->rtt_p99_us, &r->rss_master_kb, &r->rss_player_kb) != 10) {
+        return false;
+    }
+    r->ok = strcmp(status, "ok") == 0;
+    return true;
+}
+
+// Grew by more than the tolerance and by more than the slack
+static bool grew(double now, double base, double tolerance, double slack) {
+    return now > base * (1 + tolerance) && now - base > slack;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, int n) {
+    qsort(values, (size_t)n, sizeof(double), compare_doubles);
+    return (n % 2 == 1) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// Summary of one case over its seeds. Game length depends on move timing, so a
+// single seed is too noisy to compare: medians for time, the maximum for memory
+static bool summarize(const bench_result_t *results, int count, const char *name, bench_summary_t *sum) {
+    double moves[BENCH_MAX_ROWS], speed[BENCH_MAX_ROWS], wall[BENCH_MAX_ROWS], p99[BENCH_MAX_ROWS];
+    int n = 0;
+    memset(sum, 0, sizeof(*sum));
+    sum->ok = true;
+    for (int i = 0; i < count && n < BENCH_MAX_ROWS; i++) {
+        if (strcmp(results[i].name, name) != 0) {
+            continue;
+        }
+        sum->ok = sum->ok && results[i].ok;
+        moves[n] = results[i].moves;
+        speed[n] = results[i].moves_per_s;
+        wall[n] = results[i].wall_ms;
+        p99[n] = results[i].rtt_p99_us;
+        if (results[i].rss_master_kb > sum->rss_master_kb) {
+            sum->rss_master_kb = results[i].rss_master_kb;
+        }
+        if (results[i].rss_player_kb > sum->rss_player_kb) {
+            sum->rss_player_kb = results[i].rss_player_kb;
+        }
+        n++;
+    }
+    if (n == 0) {
+        return false;
+    }
+    sum->moves = median(moves, n);
+    sum->moves_per_s = median(speed, n);
+    sum->wall_ms = median(wall, n);
+    sum->rtt_p99_us = median(p99, n);
+    return true;
+}
+
+static int compare_case(const char *name, const bench_summary_t *r, const bench_summary_t *base, double tolerance) {
+    int regressions = 0;
+    if (base->ok && !r->ok) {
+        fprintf(stderr, "%s: falló (baseline ok)\n", name);
+        return 1;
+    }
+    if (!base->ok || !r->ok) {
+        return 0;
+    }
+    if (base->wall_ms >= BENCH_MIN_WALL_MS && r->moves_per_s < base->moves_per_s * (1 - tolerance)) {
+        fprintf(stderr, "%s: moves/s %.0f -> %.0f\n", name, base->moves_per_s, r->moves_per_s);
+        regressions++;
+    }
+    if (base->moves >= BENCH_MIN_P99_MOVES && grew(r->rtt_p99_us, base->rtt_p99_us, tolerance, BENCH_RTT_SLACK_US)) {
+        fprintf(stderr, "%s: rtt_p99_us %.0f -> %.0f\n", name, base->rtt_p99_us, r->rtt_p99_us);
+        regressions++;
+    }
+    if (grew(r->rss_master_kb, base->rss_master_kb, tolerance, BENCH_RSS_SLACK_KB)) {
+        fprintf(stderr, "%s: rss_master_kb %ld -> %ld\n", name, base->rss_master_kb, r->rss_master_kb);
+        regressions++;
+    }
+    if (grew(r->rss_player_kb, base->rss_player_kb, tolerance, BENCH_RSS_SLACK_KB)) {
+        fprintf(stderr, "%s: rss_player_kb %ld -> %ld\n", name, base->rss_player_kb, r->rss_player_kb);
+        regressions++;
+    }
+    return regressions;
+}
+
+int compare_with_baseline(const bench_result_t *results, int count, const char *baseline_path, double tolerance) {
+    FILE *f = fopen(baseline_path, "r");
+    if (f == NULL) {
+        perror("fopen baseline");
+        return -1;
+    }
+    static bench_result_t baseline[BENCH_MAX_ROWS];
+    int rows = 0;
+    char line[BENCH_LINE_LEN];
+    while (rows < BENCH_MAX_ROWS && fgets(line, sizeof(line), f) != NULL) {
+        if (parse_result(line, &baseline[rows])) { // skips the header
+            rows++;
+        }
+    }
+    fclose(f);
+
+    int regressions = 0;
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && strcmp(results[i].name, results[i - 1].name) == 0) {
+            continue; // rows of a case are contiguous: summarized at its first
+        }
+        bench_summary_t now, base;
+        if (summarize(baseline, rows, results[i].name, &base)) {
+            summarize(results, count, results[i].name, &now);
+            regressions += compare_case(results[i].name, &now, &base, tolerance);
+        }
+    }
+    return regressions;
+}
+
+// free_neighbor_map() against count_free_neighbors() on random boards of both
+// layouts, at widths around the vector sizes; then the time of a full map of
+// a large board. Everything goes to stderr so stdout stays TSV.
+static bool check_free_neighbor_map(void) {
+    static const unsigned short widths[] = {1, 2, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000};
+    static const unsigned short heights[] = {1, 2, 3, 17};
+    const int layouts[] = {BOARD_LAYOUT_V1, BOARD_LAYOUT_V2};
+    srand(1);
+    long mismatches = 0;
+
+    for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+            for (size_t h = 0; h < sizeof(heights) / sizeof(heights[0]); h++) {
+                unsigned short width = widths[w], height = heights[h];
+                game_state_t *gs = calloc(1, game_state_size(width, height, layouts[l]));
+                uint8_t *counts = malloc((size_t)width * height);
+                uint8_t *scratch = malloc(FREE_NEIGHBOR_SCRATCH(width));
+                if (gs == NULL || counts == NULL || scratch == NULL) {
+                    perror("malloc free_neighbor_map");
+                    free(gs);
+                    free(counts);
+                    free(scratch);
+                    return false;
+                }
+                gs->width = width;
+                gs->height = height;
+                if (layouts[l] == BOARD_LAYOUT_V2) {
+                    board_header_t *header = (board_header_t *)(void *)gs->board;
+                    header->magic = BOARD_V2_MAGIC;
+                    header->version = BOARD_LAYOUT_V2;
+                }
+                for (int y = 0; y < height; y++) {
+                    for (int x = 0; x < width; x++) {
+                        // About half taken (0 or -player), half free rewards
+                        set_cell(gs, x, y, (rand() % 2) ? 1 + rand() % 9 : -(rand() % MAX_PLAYERS));
+                    }
+                }
+
+                // The whole board, then a band in the middle
+                int y0 = height / 3, y1 = height - height / 3;
+                for (int pass = 0; pass < 2; pass++) {
+                    int from = (pass == 0) ? 0 : y0, to = (pass == 0) ? height : y1;
+                    free_neighbor_map(gs, counts, scratch, from, to);
+                    for (int y = from; y < to; y++) {
+                        for (int x = 0; x < width; x++) {
+                            if (counts[(size_t)(y - from) * width + x] != count_free_neighbors(gs, x, y)) {
+                                mismatches++;
+                            }
+                        }
+                    }
+                }
+                free(gs);
+                free(counts);
+                free(scratch);
+            }
+        }
+    }
+    if (mismatches > 0) {
+        fprintf(stderr, "free_neighbor_map: %ld celdas difieren de count_free_neighbors\n", mismatches);
+        return false;
+    }
+
+    unsigned short side = 1000;
+    game_state_t *gs = calloc(1, game_state_size(side, side, BOARD_LAYOUT_V1));
+    uint8_t *counts = malloc((size_t)side * side);
+    uint8_t *scratch = malloc(FREE_NEIGHBOR_SCRATCH(side));
+    if (gs != NULL && counts != NULL && scratch != NULL) {
+        gs->width = side;
+        gs->height = side;
+        for (int y = 0; y < side; y++) {
+            for (int x = 0; x < side; x++) {
+                set_cell(gs, x, y, (rand() % 2) ? 1 + rand() % 9 : 0);
+            }
+        }
+        free_neighbor_map(gs, counts, scratch, 0, side); // first touch of counts
+        int runs = 20;
+        long long start = monotonic_us();
+        for (int i = 0; i < runs; i++) {
+            free_neighbor_map(gs, counts, scratch, 0, side);
+        }
+        fprintf(stderr, "free_neighbor_map: ok, %ux%u en %lld us\n", side, side, (monotonic_us() - start) / runs);
+    }
+    free(gs);
+    free(counts);
+    free(scratch);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    bench_args_t args;
+    if (parse_bench_args(argc, argv, &args) == -1) {
+        exit(1);
+    }
+    if (access(args.master, X_OK) == -1 || access(args.player, X_OK) == -1) {
+        fprintf(stderr, "Error: no se encuentran %s y %s (make host-all)\n", args.master, args.player);
+        exit(1);
+    }
+    if (!check_free_neighbor_map()) {
+        exit(1);
+    }
+
+    bench_result_t results[BENCH_CASES * BENCH_SEEDS];
+    int count = 0;
+    int failed = 0;
+    fputs(bench_columns, stdout);
+    for (int c = 0; c < BENCH_CASES; c++) {
+        char name[BENCH_NAME_LEN];
+        case_name(&bench_cases[c], name, sizeof(name));
+        if (args.filter != NULL && strstr(name, args.filter) == NULL) {
+            continue;
+        }
+        for (unsigned int seed = 1; seed <= BENCH_SEEDS; seed++) {
+            run_bench_case(&args, &bench_cases[c], seed, &results[count]);
+            print_result(stdout, &results[count]);
+            fflush(stdout);
+            failed += !results[count].ok;
+            count++;
+        }
+    }
+
+    int status = (failed > 0) ? 1 : 0;
+    if (args.out_path != NULL) {
+        FILE *out = fopen(args.out_path, "w");
+        if (out == NULL) {
+            perror("fopen resultados");
+            status = 1;
+        } else {
+            fputs(bench_columns, out);
+            for (int i = 0; i < count; i++) {
+                print_result(out, &results[i]);
+            }
+            if (fclose(out) != 0) {
+                perror("fclose resultados");
+                status = 1;
+            }
+        }
+    }
+    if (args.baseline_path != NULL) {
+        int regressions = compare_with_baseline(results, count, args.baseline_path, args.tolerance);
+        if (regressions != 0) {
+            if (regressions > 0) {
+                fprintf(stderr, "%d regresiones respecto de %s (tolerancia %.0f%%)\n", regressions,
+                        args.baseline_path, args.tolerance * 100);
+            }
+            status = 1;
+        }
+    }
+    if (failed > 0) {
+        fprintf(stderr, "%d corridas fallaron\n", failed);
+    }
+    return status;
+}
@@ -0,0 +1,299 @@
+#include "bitboard.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(NO_SIMD)
+#define BITBOARD_AVX2
+#include <immintrin.h>
+#endif
+
+enum { PLANES = 1 + BB_VALUE_PLANES + 4 };  // free, values, region, frontier, next, spread
+
+bitboard_t *bitboard_create(unsigned short width, unsigned short height) {
+    bitboard_t *bb = calloc(1, sizeof(*bb));
+    if (bb == NULL) {
+        perror("calloc bitboard");
+        return NULL;
+    }
+    bb->width = width;
+    bb->height = height;
+    bb->stride = ((size_t)width + 63) / 64;
+    bb->words = ((size_t)height + 2) * bb->stride;
+    bb->store = calloc(PLANES * bb->words, sizeof(uint64_t));
+    if (bb->store == NULL) {
+        perror("calloc bitboard planes");
+        free(bb);
+        return NULL;
+    }
+
+    uint64_t *plane = bb->store;
+    bb->free = plane; plane += bb->words;
+    for (int k = 0; k < BB_VALUE_PLANES; k++) {
+        bb->value[k] = plane; plane += bb->words;
+    }
+    bb->region = plane; plane += bb->words;
+    bb->frontier = plane; plane += bb->words;
+    bb->next = plane; plane += bb->words;
+    bb->spread = plane;
+    bb->band.y0 = 0;
+    bb->band.y1 = -1;   // empty: every scratch plane is zero
+
+#ifdef BITBOARD_AVX2
+    bb->avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return bb;
+}
+
+void bitboard_destroy(bitboard_t *bb) {
+    if (bb == NULL) {
+        return;
+    }
+    free(bb->store);
+    free(bb);
+}
+
+static size_t row_index(const bitboard_t *bb, int y) {
+    return (size_t)(y + 1) * bb->stride;
+}
+
+static void load_planes(bitboard_t *bb, const game_state_t *gs) {
+    for (int y = 0; y < bb->height; y++) {
+        uint64_t *free_row = bitboard_row(bb, bb->free, y);
+        uint64_t *value_row[BB_VALUE_PLANES];
+        for (int k = 0; k < BB_VALUE_PLANES; k++) {
+            value_row[k] = bitboard_row(bb, bb->value[k], y);
+        }
+        for (size_t w = 0; w < bb->stride; w++) {
+            uint64_t free_bits = 0;
+            uint64_t value_bits[BB_VALUE_PLANES] = {0};
+            int x0 = (int)(w * 64);
+            int x1 = (x0 + 64 < bb->width) ? x0 + 64 : bb->width;
+            for (int x = x0; x < x1; x++) {
+                int v = get_cell(gs, x, y);
+                if (!is_free_cell(v)) continue;
+                uint64_t bit = (uint64_t)1 << (x - x0);
+                free_bits |= bit;
+                for (int k = 0; k < BB_VALUE_PLANES; k++) {
+                    if (v & (1 << k)) value_bits[k] |= bit;
+                }
+            }
+            free_row[w] = free_bits;
+            for (int k = 0; k < BB_VALUE_PLANES; k++) {
+                value_row[k][w] = value_bits[k];
+            }
+        }
+    }
+}
+
+void bitboard_load(bitboard_t *bb, const game_state_t *gs) {
+    load_planes(bb, gs);
+    memset(&bb->synced, 0, sizeof(bb->synced));    // the next bitboard_sync() reloads
+}
+
+static bool synced_free(const void *ctx, int x, int y) {
+    const bitboard_t *bb = ctx;
+    return bitboard_test(bb, bb->free, x, y);
+}
+
+void bitboard_sync(bitboard_t *bb, const game_state_t *gs) {
+    int cells[BOARD_DELTA_MAX];
+    int n = board_delta(&bb->synced, gs, synced_free, bb, cells, BOARD_DELTA_MAX);
+    if (n < 0) {
+        load_planes(bb, gs);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        bitboard_take(bb, cells[i] % bb->width, cells[i] / bb->width);
+    }
+}
+
+void bitboard_take(bitboard_t *bb, int x, int y) {
+    size_t i = row_index(bb, y) + (size_t)x / 64;
+    uint64_t keep = ~((uint64_t)1 << (x % 64));
+    bb->free[i] &= keep;
+    for (int k = 0; k < BB_VALUE_PLANES; k++) {
+        bb->value[k][i] &= keep;
+    }
+}
+
+static bb_rect_t full_rect(const bitboard_t *bb) {
+    bb_rect_t r = { 0, bb->height - 1, 0, bb->stride - 1 };
+    return r;
+}
+
+// Horizontal half of the dilation over rows y0..y1 (padding rows allowed) and
+// words w0..w1: each bit spreads to its left and right neighbours
+static void spread_rows(const bitboard_t *bb, const uint64_t *src, int y0, int y1, size_t w0, size_t w1) {
+    size_t s = bb->stride;
+    for (int y = y0; y <= y1; y++) {
+        size_t i = row_index(bb, y);
+        for (size_t k = w0; k <= w1; k++) {
+            uint64_t w = src[i + k];
+            uint64_t left  = (w << 1) | ((k > 0) ? src[i + k - 1] >> 63 : 0);
+            uint64_t right = (w >> 1) | ((k + 1 < s) ? src[i + k + 1] << 63 : 0);
+            bb->spread[i + k] = w | left | right;
+        }
+    }
+}
+
+// Vertical half over words [i0, i1): dst = (spread above | spread | spread below) & free & ~exclude
+static int vertical_scalar(const bitboard_t *bb, uint64_t *dst, const uint64_t *exclude, size_t i0, size_t i1) {
+    size_t s = bb->stride;
+    const uint64_t *spread = bb->spread;
+    int count = 0;
+    for (size_t i = i0; i < i1; i++) {
+        uint64_t w = (spread[i - s] | spread[i] | spread[i + s]) & bb->free[i];
+        if (exclude != NULL) w &= ~exclude[i];
+        dst[i] = w;
+        count += __builtin_popcountll(w);
+    }
+    return count;
+}
+
+#ifdef BITBOARD_AVX2
+// Same as vertical_scalar, four words per instruction
+__attribute__((target("avx2,popcnt")))
+static int vertical_avx2(const bitboard_t *bb, uint64_t *dst, const uint64_t *exclude, size_t i0, size_t i1) {
+    size_t s = bb->stride;
+    const uint64_t *spread = bb->spread;
+    size_t i = i0;
+    for (; i + 4 <= i1; i += 4) {
+        __m256i up   = _mm256_loadu_si256((const __m256i *)(const void *)(spread + i - s));
+        __m256i mid  = _mm256_loadu_si256((const __m256i *)(const void *)(spread + i));
+        __m256i down = _mm256_loadu_si256((const __m256i *)(const void *)(spread + i + s));
+        __m256i w = _mm256_or_si256(_mm256_or_si256(up, mid), down);
+        w = _mm256_and_si256(w, _mm256_loadu_si256((const __m256i *)(const void *)(bb->free + i)));
+        if (exclude != NULL) {
+            w = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i *)(const void *)(exclude + i)), w);
+        }
+        _mm256_storeu_si256((__m256i *)(void *)(dst + i), w);
+    }
+    for (; i < i1; i++) {
+        uint64_t w = (spread[i - s] | spread[i] | spread[i + s]) & bb->free[i];
+        if (exclude != NULL) w &= ~exclude[i];
+        dst[i] = w;
+    }
+
+    int count = 0;
+    for (i = i0; i < i1; i++) {
+        count += __builtin_popcountll(dst[i]);
+    }
+    return count;
+}
+#endif
+
+static int vertical(const bitboard_t *bb, uint64_t *dst, const uint64_t *exclude, size_t i0, size_t i1) {
+#ifdef BITBOARD_AVX2
+    if (bb->avx2) {
+        return vertical_avx2(bb, dst, exclude, i0, i1);
+    }
+#endif
+    return vertical_scalar(bb, dst, exclude, i0, i1);
+}
+
+// One dilation step written to rect only; src must be zero within one cell of
+// rect's outside (a flood layer never reaches further than the next one).
+static int expand_rect(const bitboard_t *bb, uint64_t *dst, const uint64_t *src, const uint64_t *exclude, const bb_rect_t *r) {
+    spread_rows(bb, src, r->y0 - 1, r->y1 + 1, r->w0, r->w1);
+    if (r->w0 == 0 && r->w1 == bb->stride - 1) {
+        // Whole rows are contiguous: one span (with one word per row, four rows per vector)
+        return vertical(bb, dst, exclude, row_index(bb, r->y0), row_index(bb, r->y1 + 1));
+    }
+    int count = 0;
+    for (int y = r->y0; y <= r->y1; y++) {
+        size_t i = row_index(bb, y);
+        count += vertical(bb, dst, exclude, i + r->w0, i + r->w1 + 1);
+    }
+    return count;
+}
+
+int bitboard_expand(bitboard_t *bb, uint64_t *dst, const uint64_t *src, const uint64_t *exclude) {
+    bb_rect_t all = full_rect(bb);
+    if (dst == bb->region || dst == bb->frontier || dst == bb->next) {
+        bb->band = all;
+    }
+    return expand_rect(bb, dst, src, exclude, &all);
+}
+
+// Zero the scratch planes where the previous flood wrote them
+static void clear_band(bitboard_t *bb) {
+    const bb_rect_t *r = &bb->band;
+    size_t words = (r->y0 <= r->y1) ? r->w1 - r->w0 + 1 : 0;
+    for (int y = r->y0; y <= r->y1; y++) {
+        size_t i = row_index(bb, y) + r->w0;
+        memset(bb->region + i, 0, words * sizeof(uint64_t));
+        memset(bb->frontier + i, 0, words * sizeof(uint64_t));
+        memset(bb->next + i, 0, words * sizeof(uint64_t));
+    }
+    bb->band.y0 = 0;
+    bb->band.y1 = -1;
+}
+
+int bitboard_flood(bitboard_t *bb, int x, int y, int max_depth, int max_cells, int *layers) {
+    clear_band(bb);
+    if (layers != NULL) {
+        memset(layers, 0, ((size_t)max_depth + 1) * sizeof(int));
+    }
+    if (x < 0 || y < 0 || x >= bb->width || y >= bb->height || !bitboard_test(bb, bb->free, x, y)) {
+        return 0;
+    }
+
+    size_t i = row_index(bb, y) + (size_t)x / 64;
+    bb->region[i] = bb->frontier[i] = (uint64_t)1 << (x % 64);
+    bb->band.y0 = bb->band.y1 = y;
+    bb->band.w0 = bb->band.w1 = (size_t)x / 64;
+    int size = 1;
+    if (layers != NULL) layers[0] = 1;
+
+    for (int d = 1; d <= max_depth && size < max_cells; d++) {
+        // Layer d lies within d rows and columns of the start
+        bb_rect_t r;
+        r.y0 = (y - d > 0) ? y - d : 0;
+        r.y1 = (y + d < bb->height - 1) ? y + d : bb->height - 1;
+        r.w0 = (size_t)((x - d > 0) ? x - d : 0) / 64;
+        r.w1 = (size_t)((x + d < bb->width - 1) ? x + d : bb->width - 1) / 64;
+        bb->band = r;
+        int added = expand_rect(bb, bb->next, bb->frontier, bb->region, &r);
+        if (added == 0) break;
+        for (int row = r.y0; row <= r.y1; row++) {
+            size_t base = row_index(bb, row);
+            for (size_t w = r.w0; w <= r.w1; w++) {
+                bb->region[base + w] |= bb->next[base + w];
+            }
+        }
+        uint64_t *t = bb->frontier; bb->frontier = bb->next; bb->next = t;
+        size += added;
+        if (layers != NULL) layers[d] = added;
+    }
+    return size;
+}
+
+int bitboard_value(const bitboard_t *bb, const uint64_t *plane, const bb_rect_t *rect) {
+    bb_rect_t r = (rect != NULL) ? *rect : full_rect(bb);
+    int sum = 0;
+    for (int k = 0; k < BB_VALUE_PLANES; k++) {
+        int count = 0;
+        for (int y = r.y0; y <= r.y1; y++) {
+            size_t base = row_index(bb, y);
+            for (size_t w = r.w0; w <= r.w1; w++) {
+                count += __builtin_popcountll(plane[base + w] & bb->value[k][base + w]);
+            }
+        }
+        sum += count << k;
+    }
+    return sum;
+}
+
+int bitboard_count(const bitboard_t *bb, const uint64_t *plane, const bb_rect_t *rect) {
+    bb_rect_t r = (rect != NULL) ? *rect : full_rect(bb);
+    int count = 0;
+    for (int y = r.y0; y <= r.y1; y++) {
+        size_t base = row_index(bb, y);
+        for (size_t w = r.w0; w <= r.w1; w++) {
+            count += __builtin_popcountll(plane[base + w]);
+        }
+    }
+    return count;
+}
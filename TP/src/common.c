@@ -1,4 +1,6 @@
+#define _GNU_SOURCE
 #include "common.h"
+#include <sched.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -7,11 +9,64 @@
 #include <string.h>
 #include <unistd.h>
 
-game_state_t* allocate_game_state_shm(unsigned short width, unsigned short height) {
-    size_t board_size = width * height * sizeof(int);
-    size_t total_size = sizeof(game_state_t) + board_size;
+static char shm_instance[SHM_INSTANCE_LEN];
+static bool shm_instance_loaded = false;
+
+void shm_set_instance(const char *instance) {
+    if (instance == NULL) {
+        instance = getenv(SHM_INSTANCE_ENV);
+    }
+    snprintf(shm_instance, sizeof(shm_instance), "%s", instance != NULL ? instance : "");
+    shm_instance_loaded = true;
+}
+
+void shm_name(char *buf, size_t len, const char *base) {
+    if (!shm_instance_loaded) {
+        shm_set_instance(NULL);
+    }
+    if (shm_instance[0] == '\0') {
+        snprintf(buf, len, "%s", base);
+    } else {
+        snprintf(buf, len, "%s.%s", base, shm_instance);
+    }
+}
+
+size_t board_size(unsigned short width, unsigned short height, int layout) {
+    size_t cells = (size_t)width * height;
+    if (layout == BOARD_LAYOUT_V2) {
+        return sizeof(board_header_t) + cells * sizeof(int8_t);
+    }
+    return cells * sizeof(int);
+}
+
+size_t game_state_size(unsigned short width, unsigned short height, int layout) {
+    return sizeof(game_state_t) + board_size(width, height, layout);
+}
+
+void snapshot_game_state(game_state_t *dst, const game_state_t *src, sync_t *sync) {
+    size_t bytes = board_size(src->width, src->height, board_layout(src));
+    for (unsigned int attempt = 0; ; attempt++) {
+        unsigned int seq = __atomic_load_n(&sync->state_seq, __ATOMIC_ACQUIRE);
+        if ((seq & 1) == 0) {
+            memcpy(dst, src, sizeof(game_state_t));
+            memcpy(dst->board, src->board, bytes);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&sync->state_seq, __ATOMIC_RELAXED) == seq) {
+                return;
+            }
+        }
+        if (attempt >= SNAPSHOT_SPINS) {
+            sched_yield();
+        }
+    }
+}
+
+game_state_t* allocate_game_state_shm(unsigned short width, unsigned short height, int layout) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_STATE);
+    size_t total_size = game_state_size(width, height, layout);
     
-    int shm_fd = shm_open(SHM_STATE, O_CREAT | O_RDWR, 0777);
+    int shm_fd = shm_open(name, O_CREAT | O_RDWR, 0777);
     if (shm_fd == -1) {
         perror("shm_open failed for game state");
         return NULL;
@@ -19,18 +74,23 @@ game_state_t* allocate_game_state_shm(unsigned short width, unsigned short heigh
     
     if (ftruncate(shm_fd, total_size) == -1) {
         perror("ftruncate failed for game state");
-        shm_unlink(SHM_STATE);
+        shm_unlink(name);
         return NULL;
     }
     
     game_state_t* game_state = (game_state_t*)mmap(NULL, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
     if (game_state == MAP_FAILED) {
         perror("mmap failed for game state");
-        shm_unlink(SHM_STATE);
+        shm_unlink(name);
         return NULL;
     }
     
     memset(game_state, 0, total_size);
+    if (layout == BOARD_LAYOUT_V2) {
+        board_header_t* header = (board_header_t*)(void*)game_state->board;
+        header->magic = BOARD_V2_MAGIC;
+        header->version = BOARD_LAYOUT_V2;
+    }
 
     close(shm_fd);
     
@@ -38,9 +98,11 @@ game_state_t* allocate_game_state_shm(unsigned short width, unsigned short heigh
 }
 
 sync_t* allocate_sync_shm(void) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_SYNC);
     size_t size = sizeof(sync_t);
     
-    int shm_fd = shm_open(SHM_SYNC, O_CREAT | O_RDWR, 0777);
+    int shm_fd = shm_open(name, O_CREAT | O_RDWR, 0777);
     if (shm_fd == -1) {
         perror("shm_open failed for sync");
         return NULL;
@@ -48,18 +110,19 @@ sync_t* allocate_sync_shm(void) {
     
     if (ftruncate(shm_fd, size) == -1) {
         perror("ftruncate failed for sync");
-        shm_unlink(SHM_SYNC);
+        shm_unlink(name);
         return NULL;
     }
     
     sync_t* sync = (sync_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
     if (sync == MAP_FAILED) {
         perror("mmap failed for sync");
-        shm_unlink(SHM_SYNC);
+        shm_unlink(name);
         return NULL;
     }
     
     sync->reader_count = 0;
+    sync->state_seq = 0;
 
     close(shm_fd);
     
@@ -67,7 +130,9 @@ sync_t* allocate_sync_shm(void) {
 }
 
 game_state_t* attach_game_state_shm_readonly(void) {
-    int shm_fd = shm_open(SHM_STATE, O_RDONLY, 0);
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_STATE);
+    int shm_fd = shm_open(name, O_RDONLY, 0);
     if (shm_fd == -1) {
         perror("shm_open failed for game state attachment");
         return NULL;
@@ -91,9 +156,11 @@ game_state_t* attach_game_state_shm_readonly(void) {
 }
 
 sync_t* attach_sync_shm(void) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_SYNC);
     size_t size = sizeof(sync_t);
     
-    int shm_fd = shm_open(SHM_SYNC, O_RDWR, 0);
+    int shm_fd = shm_open(name, O_RDWR, 0);
     if (shm_fd == -1) {
         perror("shm_open failed for sync attachment");
         return NULL;
@@ -111,11 +178,14 @@ sync_t* attach_sync_shm(void) {
 }
 
 void cleanup_shared_memory(void) {
-    if (shm_unlink(SHM_STATE) == -1) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_STATE);
+    if (shm_unlink(name) == -1) {
         perror("shm_unlink failed for game state");
     }
     
-    if (shm_unlink(SHM_SYNC) == -1) {
+    shm_name(name, sizeof(name), SHM_SYNC);
+    if (shm_unlink(name) == -1) {
         perror("shm_unlink failed for sync");
     }
 }
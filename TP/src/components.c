@@ -0,0 +1,232 @@
+#include "components.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPLIT_BUDGET 64  // cells each side of a possible cut is searched for before the budget doubles
+
+components_t *components_create(unsigned short width, unsigned short height) {
+    components_t *comps = calloc(1, sizeof(*comps));
+    if (comps == NULL) {
+        perror("calloc components");
+        return NULL;
+    }
+    size_t cells = (size_t)width * height;
+    comps->width = width;
+    comps->height = height;
+    comps->label = malloc(cells * sizeof(int));
+    comps->value = malloc(cells);
+    comps->size = malloc(cells * sizeof(int));
+    comps->sum = malloc(cells * sizeof(int));
+    comps->queue = malloc(cells * sizeof(int));
+    comps->stamp = calloc(cells, sizeof(uint32_t));
+    if (comps->label == NULL || comps->value == NULL || comps->size == NULL ||
+        comps->sum == NULL || comps->queue == NULL || comps->stamp == NULL) {
+        perror("malloc components");
+        components_destroy(comps);
+        return NULL;
+    }
+    return comps;
+}
+
+void components_destroy(components_t *comps) {
+    if (comps == NULL) {
+        return;
+    }
+    free(comps->label);
+    free(comps->value);
+    free(comps->size);
+    free(comps->sum);
+    free(comps->queue);
+    free(comps->stamp);
+    free(comps);
+}
+
+static void relabel(components_t *comps, const game_state_t *gs) {
+    int width = comps->width, height = comps->height;
+    size_t cells = (size_t)width * height;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t i = (size_t)y * width + (size_t)x;
+            int v = get_cell(gs, x, y);
+            comps->label[i] = COMPONENT_NONE;
+            comps->value[i] = is_free_cell(v) ? (signed char)v : 0;
+        }
+    }
+
+    comps->count = 0;
+    for (size_t start = 0; start < cells; start++) {
+        if (comps->value[start] == 0 || comps->label[start] != COMPONENT_NONE) continue;
+        int id = comps->count++;
+        int size = 0, sum = 0;
+        size_t head = 0, tail = 0;
+        comps->label[start] = id;
+        comps->queue[tail++] = (int)start;
+        while (head < tail) {
+            int i = comps->queue[head++];
+            int x = i % width, y = i / width;
+            size++;
+            sum += comps->value[i];
+            for (int k = 0; k < 8; k++) {
+                int nx = x + DIRS[k][0];
+                int ny = y + DIRS[k][1];
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                int j = ny * width + nx;
+                if (comps->value[j] == 0 || comps->label[j] != COMPONENT_NONE) continue;
+                comps->label[j] = id;
+                comps->queue[tail++] = j;
+            }
+        }
+        comps->size[id] = size;
+        comps->sum[id] = sum;
+    }
+    comps->relabels++;
+}
+
+// Free neighbours of (x, y) grouped by adjacency among themselves, one cell
+// index per group. Removing the cell keeps its component connected if there is
+// at most one group: any path through the cell can go around it.
+static int neighbour_groups(const components_t *comps, int x, int y, int *reps) {
+    int nx[8], ny[8], group[8];
+    int n = 0;
+    for (int k = 0; k < 8; k++) {
+        int cx = x + DIRS[k][0];
+        int cy = y + DIRS[k][1];
+        if (cx < 0 || cy < 0 || cx >= comps->width || cy >= comps->height) continue;
+        if (components_label(comps, cx, cy) == COMPONENT_NONE) continue;
+        nx[n] = cx;
+        ny[n] = cy;
+        group[n] = n;
+        n++;
+    }
+
+    for (int a = 0; a < n; a++) {
+        for (int b = a + 1; b < n; b++) {
+            if (abs(nx[a] - nx[b]) > 1 || abs(ny[a] - ny[b]) > 1 || group[a] == group[b]) continue;
+            int from = group[b], to = group[a];
+            for (int c = 0; c < n; c++) {
+                if (group[c] == from) group[c] = to;
+            }
+        }
+    }
+    int groups = 0;
+    for (int a = 0; a < n; a++) {
+        if (group[a] == a) reps[groups++] = ny[a] * comps->width + nx[a];
+    }
+    return groups;
+}
+
+// BFS over component id from reps[self], giving up after budget cells or on
+// reaching the start of a side that is still open or merged into one (*hit). The cells seen are left in
+// comps->queue.
+// @return: their number if the search ran out of cells (a closed-off piece), else 0
+static int probe(components_t *comps, int id, const int *reps, const int *group, int groups, int self,
+                 int budget, int *hit) {
+    int width = comps->width, height = comps->height;
+    if (++comps->generation == 0) {
+        memset(comps->stamp, 0, (size_t)width * height * sizeof(uint32_t));
+        comps->generation = 1;
+    }
+    uint32_t gen = comps->generation;
+    size_t head = 0, tail = 0;
+    comps->stamp[reps[self]] = gen;
+    comps->queue[tail++] = reps[self];
+    while (head < tail) {
+        int i = comps->queue[head++];
+        for (int g = 0; g < groups; g++) {
+            if (reps[g] == i && group[g] >= 0 && group[g] != self) {
+                *hit = group[g];
+                return 0;
+            }
+        }
+        if ((int)tail >= budget) {
+            return 0;
+        }
+        int x = i % width, y = i / width;
+        for (int k = 0; k < 8; k++) {
+            int nx = x + DIRS[k][0];
+            int ny = y + DIRS[k][1];
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+            int j = ny * width + nx;
+            if (comps->stamp[j] == gen || comps->label[j] != id) continue;
+            comps->stamp[j] = gen;
+            comps->queue[tail++] = j;
+        }
+    }
+    return (int)tail;
+}
+
+// After a removal left groups > 1 sides of component id: searches from each
+// side in turn with a doubling budget, merging sides that meet and giving each
+// closed-off piece a new label, until one side is left to keep id.
+static bool split(components_t *comps, int id, const int *reps, int groups) {
+    int group[8];   // group[g] == g: side still open; another side it met; -1: labelled off
+    for (int g = 0; g < groups; g++) group[g] = g;
+    int open = groups;
+    for (int budget = SPLIT_BUDGET; open > 1; budget *= 2) {
+        for (int g = 0; g < groups && open > 1; g++) {
+            if (group[g] != g) continue;
+            int hit = -1;
+            int cells = probe(comps, id, reps, group, groups, g, budget, &hit);
+            if (hit >= 0) {
+                for (int c = 0; c < groups; c++) {
+                    if (group[c] == g) group[c] = hit;
+                }
+                open--;
+            } else if (cells > 0) {
+                if (comps->count == comps->width * comps->height) {
+                    return false;   // out of labels
+                }
+                int piece = comps->count++, sum = 0;
+                for (int k = 0; k < cells; k++) {
+                    comps->label[comps->queue[k]] = piece;
+                    sum += comps->value[comps->queue[k]];
+                }
+                comps->size[piece] = cells;
+                comps->sum[piece] = sum;
+                comps->size[id] -= cells;
+                comps->sum[id] -= sum;
+                for (int c = 0; c < groups; c++) {
+                    if (group[c] == g) group[c] = -1;
+                }
+                open--;
+            }
+        }
+    }
+    comps->splits++;
+    return true;
+}
+
+static bool remove_cell(components_t *comps, int x, int y) {
+    size_t i = (size_t)y * comps->width + (size_t)x;
+    int id = comps->label[i];
+    if (id == COMPONENT_NONE) {
+        return false;
+    }
+    comps->size[id]--;
+    comps->sum[id] -= comps->value[i];
+    comps->label[i] = COMPONENT_NONE;
+    comps->value[i] = 0;
+    comps->removals++;
+
+    int reps[8];
+    int groups = neighbour_groups(comps, x, y, reps);
+    return groups <= 1 || split(comps, id, reps, groups);
+}
+
+static bool labelled(const void *ctx, int x, int y) {
+    return components_label(ctx, x, y) != COMPONENT_NONE;
+}
+
+void components_update(components_t *comps, const game_state_t *gs) {
+    int cells[BOARD_DELTA_MAX];
+    int n = board_delta(&comps->synced, gs, labelled, comps, cells, BOARD_DELTA_MAX);
+    bool incremental = n >= 0;
+    for (int k = 0; incremental && k < n; k++) {
+        incremental = remove_cell(comps, cells[k] % comps->width, cells[k] / comps->width);
+    }
+    if (!incremental) {
+        relabel(comps, gs);
+    }
+}
@@ -0,0 +1,391 @@
+#define _GNU_SOURCE
+#include "event.h"
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define EVENT_BATCH 64
+#define URING_ENTRIES 64
+#define URING_REMOVE_TAG (1ULL << 63)
+
+typedef struct {
+    int fd;
+    int tag;
+    unsigned int gen;   // bumped on removal so stale completions are ignored
+    bool active;
+    bool armed;         // io_uring: a one-shot POLL_ADD is in flight
+} event_reg_t;
+
+typedef struct {
+    int fd;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size, sqes_size;
+    unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned int *cq_head, *cq_tail, *cq_mask;
+    unsigned int sq_entries;
+    unsigned int to_submit;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+} uring_t;
+
+struct event_loop {
+    event_backend_t backend;
+    int epoll_fd;
+    uring_t ring;
+    event_reg_t *regs;
+    int reg_count, reg_cap;
+};
+
+int parse_event_backend(const char *name, event_backend_t *backend) {
+    if (strcmp(name, "epoll") == 0) {
+        *backend = EVENT_BACKEND_EPOLL;
+        return 0;
+    }
+    if (strcmp(name, "io_uring") == 0) {
+        *backend = EVENT_BACKEND_IO_URING;
+        return 0;
+    }
+    return -1;
+}
+
+/* ========= registrations ========= */
+
+static int find_reg(const event_loop_t *loop, int fd) {
+    for (int i = 0; i < loop->reg_count; i++) {
+        if (loop->regs[i].active && loop->regs[i].fd == fd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int new_reg(event_loop_t *loop, int fd, int tag) {
+    int slot = -1;
+    for (int i = 0; i < loop->reg_count && slot < 0; i++) {
+        if (!loop->regs[i].active && !loop->regs[i].armed) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        if (loop->reg_count == loop->reg_cap) {
+            int cap = loop->reg_cap ? loop->reg_cap * 2 : 16;
+            event_reg_t *regs = realloc(loop->regs, (size_t)cap * sizeof(*regs));
+            if (regs == NULL) {
+                return -1;
+            }
+            loop->regs = regs;
+            loop->reg_cap = cap;
+        }
+        slot = loop->reg_count++;
+        loop->regs[slot].gen = 0;
+    }
+    loop->regs[slot].fd = fd;
+    loop->regs[slot].tag = tag;
+    loop->regs[slot].active = true;
+    loop->regs[slot].armed = false;
+    return slot;
+}
+
+/* ========= io_uring (raw syscalls, one-shot POLL_ADD re-armed per wait) ========= */
+
+static int uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags, void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int uring_setup(uring_t *r) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    r->fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    if (r->fd < 0) {
+        return -1;
+    }
+
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_size > r->sq_size) {
+            r->sq_size = r->cq_size;
+        }
+        r->cq_size = r->sq_size;
+    }
+
+    r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) {
+        close(r->fd);
+        return -1;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ptr = r->sq_ptr;
+    } else {
+        r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) {
+            munmap(r->sq_ptr, r->sq_size);
+            close(r->fd);
+            return -1;
+        }
+    }
+
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        if (r->cq_ptr != r->sq_ptr) {
+            munmap(r->cq_ptr, r->cq_size);
+        }
+        munmap(r->sq_ptr, r->sq_size);
+        close(r->fd);
+        return -1;
+    }
+
+    char *sq = r->sq_ptr;
+    char *cq = r->cq_ptr;
+    r->sq_head  = (unsigned int *)(sq + p.sq_off.head);
+    r->sq_tail  = (unsigned int *)(sq + p.sq_off.tail);
+    r->sq_mask  = (unsigned int *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned int *)(sq + p.sq_off.array);
+    r->cq_head  = (unsigned int *)(cq + p.cq_off.head);
+    r->cq_tail  = (unsigned int *)(cq + p.cq_off.tail);
+    r->cq_mask  = (unsigned int *)(cq + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->sq_entries = p.sq_entries;
+    r->to_submit = 0;
+    return 0;
+}
+
+static void uring_teardown(uring_t *r) {
+    munmap(r->sqes, r->sqes_size);
+    if (r->cq_ptr != r->sq_ptr) {
+        munmap(r->cq_ptr, r->cq_size);
+    }
+    munmap(r->sq_ptr, r->sq_size);
+    close(r->fd);
+}
+
+static struct io_uring_sqe *uring_get_sqe(uring_t *r) {
+    unsigned int tail = *r->sq_tail;
+    if (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+        if (uring_enter(r->fd, r->to_submit, 0, 0, NULL, 0) < 0) {
+            return NULL;
+        }
+        r->to_submit = 0;
+        if (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+    unsigned int idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->to_submit++;
+    return sqe;
+}
+
+static uint64_t reg_user_data(const event_loop_t *loop, int slot) {
+    return ((uint64_t)(loop->regs[slot].gen & 0x7fffffffu) << 32) | (uint32_t)slot;
+}
+
+static int uring_arm(event_loop_t *loop, int slot) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&loop->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = loop->regs[slot].fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = reg_user_data(loop, slot);
+    loop->regs[slot].armed = true;
+    return 0;
+}
+
+static int uring_disarm(event_loop_t *loop, int slot) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&loop->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = reg_user_data(loop, slot);
+    sqe->user_data = URING_REMOVE_TAG;
+    return 0;
+}
+
+static int uring_reap(event_loop_t *loop, int *tags, int max_tags) {
+    uring_t *r = &loop->ring;
+    unsigned int head = *r->cq_head;
+    unsigned int tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    int n = 0;
+
+    while (head != tail && n < max_tags) {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        uint64_t ud = cqe->user_data;
+        head++;
+        if (ud & URING_REMOVE_TAG) {
+            continue;
+        }
+        int slot = (int)(ud & 0xffffffffu);
+        if (slot >= loop->reg_count) {
+            continue;
+        }
+        event_reg_t *reg = &loop->regs[slot];
+        if (((ud >> 32) & 0x7fffffffu) != (reg->gen & 0x7fffffffu)) {
+            // Completion of a poll cancelled by event_loop_remove()
+            reg->armed = false;
+            continue;
+        }
+        reg->armed = false;
+        if (reg->active && cqe->res != -ECANCELED) {
+            tags[n++] = reg->tag;
+        }
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+static int uring_wait(event_loop_t *loop, int *tags, int max_tags, int timeout_ms) {
+    uring_t *r = &loop->ring;
+    for (int i = 0; i < loop->reg_count; i++) {
+        if (loop->regs[i].active && !loop->regs[i].armed && uring_arm(loop, i) == -1) {
+            return -1;
+        }
+    }
+
+    int n = uring_reap(loop, tags, max_tags);
+    if (n > 0) {
+        return n;
+    }
+
+    unsigned int flags = IORING_ENTER_GETEVENTS;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    void *argp = NULL;
+    size_t argsz = 0;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000LL;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        argp = &arg;
+        argsz = sizeof(arg);
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+
+    int rc = uring_enter(r->fd, r->to_submit, 1, flags, argp, argsz);
+    if (rc >= 0) {
+        r->to_submit -= (unsigned int)rc < r->to_submit ? (unsigned int)rc : r->to_submit;
+    } else if (errno == ETIME) {
+        r->to_submit = 0;
+        return 0;
+    } else {
+        return -1;
+    }
+    return uring_reap(loop, tags, max_tags);
+}
+
+/* ========= API ========= */
+
+event_loop_t *event_loop_create(event_backend_t backend) {
+    event_loop_t *loop = calloc(1, sizeof(*loop));
+    if (loop == NULL) {
+        perror("calloc event loop");
+        return NULL;
+    }
+    loop->backend = backend;
+    loop->epoll_fd = -1;
+
+    if (backend == EVENT_BACKEND_IO_URING) {
+        if (uring_setup(&loop->ring) == -1) {
+            perror("io_uring_setup");
+            free(loop);
+            return NULL;
+        }
+        return loop;
+    }
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd == -1) {
+        perror("epoll_create1");
+        free(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+int event_loop_add(event_loop_t *loop, int fd, int tag) {
+    if (tag < 0 || find_reg(loop, fd) >= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    int slot = new_reg(loop, fd, tag);
+    if (slot < 0) {
+        return -1;
+    }
+    if (loop->backend == EVENT_BACKEND_IO_URING) {
+        return 0; // armed lazily by the next wait
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = (uint64_t)tag;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        loop->regs[slot].active = false;
+        return -1;
+    }
+    return 0;
+}
+
+int event_loop_remove(event_loop_t *loop, int fd) {
+    int slot = find_reg(loop, fd);
+    if (slot < 0) {
+        errno = ENOENT;
+        return -1;
+    }
+    int rc = 0;
+    if (loop->backend == EVENT_BACKEND_IO_URING) {
+        if (loop->regs[slot].armed) {
+            rc = uring_disarm(loop, slot);
+        }
+    } else {
+        rc = epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    loop->regs[slot].active = false;
+    loop->regs[slot].gen++;
+    return rc;
+}
+
+int event_loop_wait(event_loop_t *loop, int *tags, int max_tags, int timeout_ms) {
+    if (loop->backend == EVENT_BACKEND_IO_URING) {
+        return uring_wait(loop, tags, max_tags, timeout_ms);
+    }
+
+    struct epoll_event evs[EVENT_BATCH];
+    int cap = max_tags < EVENT_BATCH ? max_tags : EVENT_BATCH;
+    int n = epoll_wait(loop->epoll_fd, evs, cap, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        tags[i] = (int)evs[i].data.u64;
+    }
+    return n;
+}
+
+void event_loop_destroy(event_loop_t *loop) {
+    if (loop == NULL) {
+        return;
+    }
+    if (loop->backend == EVENT_BACKEND_IO_URING) {
+        uring_teardown(&loop->ring);
+    } else {
+        close(loop->epoll_fd);
+    }
+    free(loop->regs);
+    free(loop);
+}
@@ -0,0 +1,138 @@
+#define _GNU_SOURCE
+#include "inproc.h"
+#include "util.h"
+#include <dlfcn.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+bool is_inproc_spec(const char *path) {
+    return strncmp(path, INPROC_PREFIX, strlen(INPROC_PREFIX)) == 0;
+}
+
+int inproc_load(inproc_player_t *player, const char *spec) {
+    char lib[256];
+    const char *path = spec + strlen(INPROC_PREFIX);
+    const char *symbol = strchr(path, ':');
+    size_t len = (symbol != NULL) ? (size_t)(symbol - path) : strlen(path);
+    if (len == 0 || len >= sizeof(lib)) {
+        fprintf(stderr, "Invalid in-process player '%s'\n", spec);
+        return -1;
+    }
+    memcpy(lib, path, len);
+    lib[len] = '\0';
+    symbol = (symbol != NULL && symbol[1] != '\0') ? symbol + 1 : INPROC_DEFAULT_SYMBOL;
+
+    memset(player, 0, sizeof(*player));
+    player->handle = dlopen(lib, RTLD_NOW | RTLD_LOCAL);
+    if (player->handle == NULL) {
+        fprintf(stderr, "dlopen %s: %s\n", lib, dlerror());
+        return -1;
+    }
+    // POSIX-sanctioned way to turn a data pointer from dlsym into a function pointer
+    *(void **)(&player->strategy) = dlsym(player->handle, symbol);
+    if (player->strategy == NULL) {
+        fprintf(stderr, "dlsym %s in %s: %s\n", symbol, lib, dlerror());
+        dlclose(player->handle);
+        player->handle = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void inproc_bind(inproc_player_t *player, game_state_t *gs, sync_t *sync, const move_journal_t *journal, int id, int notify_fd) {
+    if (player->mirror != NULL && player->gs != gs) {
+        mirror_destroy(player->mirror);
+        player->mirror = NULL;
+    }
+    if (player->mirror == NULL) {
+        player->mirror = mirror_create(gs, journal);  // NULL: the strategy reads gs under reader_lock
+    }
+    player->gs = gs;
+    player->sync = sync;
+    player->id = id;
+    player->notify_fd = notify_fd;
+    player->credits = 0;
+    player->busy = 0;
+    player->done = 0;
+    player->result = -1;
+}
+
+static void inproc_task(void *arg) {
+    inproc_player_t *player = arg;
+    int move[2];
+    int result = -1;
+    int found;
+    if (player->mirror != NULL) {
+        mirror_update(player->mirror, player->gs, player->sync);
+        found = player->strategy(move, player->mirror->state, NULL, player->id);
+    } else {
+        found = player->strategy(move, player->gs, player->sync, player->id);
+    }
+    if (found == 0) {
+        unsigned char dir = direction_to_char(move);
+        result = (dir < 8) ? (int)dir : -1;
+    }
+    player->result = result;
+    __atomic_store_n(&player->done, 1, __ATOMIC_RELEASE);
+
+    uint64_t one = 1;
+    while (write(player->notify_fd, &one, sizeof(one)) == -1) {
+        // EAGAIN: counter saturated, the master is behind on reads anyway
+        sched_yield();
+    }
+}
+
+static void inproc_request(inproc_player_t *player, thread_pool_t *pool) {
+    if (player->busy || player->credits == 0) {
+        return;
+    }
+    player->credits--;
+    player->busy = 1;
+    if (pool_submit(pool, inproc_task, player) == -1) {
+        // Queue sized for every in-process player: cannot happen, but keep the credit
+        player->credits++;
+        player->busy = 0;
+    }
+}
+
+void inproc_grant(inproc_player_t *player, thread_pool_t *pool) {
+    player->credits++;
+    inproc_request(player, pool);
+}
+
+bool inproc_collect(inproc_player_t *player, thread_pool_t *pool, int *move) {
+    if (!player->busy || !__atomic_load_n(&player->done, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *move = player->result;
+    player->done = 0;
+    player->busy = 0;
+    if (*move >= 0) {
+        inproc_request(player, pool);
+    }
+    return true;
+}
+
+void inproc_release(inproc_player_t *player) {
+    player->credits = 0;
+}
+
+bool inproc_idle(inproc_player_t *player) {
+    if (player->busy && __atomic_load_n(&player->done, __ATOMIC_ACQUIRE)) {
+        player->busy = 0;
+        player->done = 0;
+    }
+    return !player->busy;
+}
+
+void inproc_unload(inproc_player_t *player) {
+    mirror_destroy(player->mirror);
+    player->mirror = NULL;
+    if (player->handle != NULL) {
+        dlclose(player->handle);
+        player->handle = NULL;
+    }
+}
@@ -0,0 +1,114 @@
+#include "journal.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+move_journal_t* allocate_journal_shm(void) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_JOURNAL);
+    size_t size = sizeof(move_journal_t);
+
+    int shm_fd = shm_open(name, O_CREAT | O_RDWR, 0777);
+    if (shm_fd == -1) {
+        perror("shm_open failed for move journal");
+        return NULL;
+    }
+
+    if (ftruncate(shm_fd, size) == -1) {
+        perror("ftruncate failed for move journal");
+        close(shm_fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    move_journal_t* journal = (move_journal_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (journal == MAP_FAILED) {
+        perror("mmap failed for move journal");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    memset(journal, 0, size);
+    journal->owner = getpid();
+    return journal;
+}
+
+const move_journal_t* attach_journal_shm(void) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_JOURNAL);
+    int shm_fd = shm_open(name, O_RDONLY, 0);
+    if (shm_fd == -1) {
+        return NULL;
+    }
+
+    move_journal_t* journal = (move_journal_t*)mmap(NULL, sizeof(move_journal_t), PROT_READ, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (journal == MAP_FAILED) {
+        return NULL;
+    }
+    if (journal->owner != getppid()) {
+        munmap(journal, sizeof(move_journal_t));
+        return NULL;
+    }
+
+    return journal;
+}
+
+void cleanup_journal_shm(void) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_JOURNAL);
+    shm_unlink(name);
+}
+
+void journal_new_game(move_journal_t *journal) {
+    __atomic_store_n(&journal->game, journal->game + 1, __ATOMIC_RELEASE);
+}
+
+void journal_append(move_journal_t *journal, const journal_entry_t *entry) {
+    unsigned int seq = journal->head + 1;
+    journal_entry_t *slot = &journal->entries[seq & (JOURNAL_CAPACITY - 1)];
+
+    // Per-slot seqlock: a reader copying the slot meanwhile sees seq change
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->player = entry->player;
+    slot->valid = entry->valid;
+    slot->value = entry->value;
+    slot->kind = entry->kind;
+    slot->from_x = entry->from_x;
+    slot->from_y = entry->from_y;
+    slot->to_x = entry->to_x;
+    slot->to_y = entry->to_y;
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&journal->head, seq, __ATOMIC_RELEASE);
+}
+
+unsigned int journal_head(const move_journal_t *journal) {
+    return __atomic_load_n(&journal->head, __ATOMIC_ACQUIRE);
+}
+
+int journal_read(const move_journal_t *journal, unsigned int since, journal_entry_t *out, int max) {
+    unsigned int head = journal_head(journal);
+    if (head - since > JOURNAL_CAPACITY) {
+        return -1;
+    }
+    int count = 0;
+    for (unsigned int seq = since + 1; seq != head + 1 && count < max; seq++) {
+        const journal_entry_t *slot = &journal->entries[seq & (JOURNAL_CAPACITY - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq) {
+            return -1;
+        }
+        memcpy(&out[count], slot, sizeof(*slot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+            return -1;  // rewritten while being copied
+        }
+        count++;
+    }
+    return count;
+}
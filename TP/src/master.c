@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include "master.h"
 #include "sync.h"
 #include "util.h"
@@ -10,12 +11,20 @@
 #include <stdlib.h>
 #include <time.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <unistd.h>
-#include <sys/select.h>
 #include <limits.h>
 #include <string.h>
 #include <errno.h>
 #include <math.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <stdint.h>
 
 static void print_player_exit(const game_state_t* gs, int idx, int exit_code) {
     char namebuf[sizeof(gs->players[0].name)];
@@ -29,64 +38,213 @@ static void print_player_exit(const game_state_t* gs, int idx, int exit_code) {
     fflush(stdout);
 }
 
-static void prepare_fd_set(fd_set* read_fds, const game_state_t* gs, int fds[][2], int num_players, int start_player, sync_t * sync) {
-    FD_ZERO(read_fds);
-    for (int j = 0; j < num_players; j++) {
-        int player_idx = (start_player + j) % num_players;
-        reader_lock(sync);
-        if (!gs->players[player_idx].blocked) {
-            FD_SET(fds[player_idx][0], read_fds);
+static void unwatch_channel(player_channel_t* channel, event_loop_t* loop) {
+    if (channel->in_loop) {
+        event_loop_remove(loop, channel->fd);
+        channel->in_loop = false;
+    }
+}
+
+int drain_player_channel(player_channel_t* channel, event_loop_t* loop) {
+    int queued = 0;
+    while (channel->pending_count < PENDING_MOVES) {
+        unsigned char buf[PENDING_MOVES];
+        size_t room = (size_t)(PENDING_MOVES - channel->pending_count);
+        ssize_t n = read(channel->fd, buf, room);
+        if (n == 0) {
+            channel->eof = true;
+            unwatch_channel(channel, loop);
+            break;
         }
-        reader_unlock(sync);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break; // EAGAIN: pipe drained
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            int tail = (channel->pending_head + channel->pending_count) % PENDING_MOVES;
+            channel->pending[tail] = buf[i];
+            channel->pending_count++;
+        }
+        queued += (int)n;
     }
+    return queued;
 }
 
-void handle_player_event(int player_idx, game_state_t* gs, sync_t* sync, int player_fd, time_t* last_successful_move_time) {
-    unsigned char mov;
-    ssize_t n = read(player_fd, &mov, 1);
-    if (n == 0) {
-        reader_lock(sync);
-        gs->players[player_idx].blocked = true;
-        reader_unlock(sync);
-        return;
+static bool uses_ring(const player_channel_t* channel) {
+    return channel->ring != NULL && __atomic_load_n(&channel->ring->active, __ATOMIC_ACQUIRE);
+}
+
+int drain_player_ring(player_channel_t* channel, event_loop_t* loop) {
+    if (!uses_ring(channel) || channel->eof) {
+        return 0;
     }
-    if (n != 1) {
-        return;
+    bool closed = __atomic_load_n(&channel->ring->closed, __ATOMIC_ACQUIRE);
+    int room = PENDING_MOVES - channel->pending_count;
+    unsigned char buf[PENDING_MOVES];
+    int n = move_ring_pop(channel->ring, buf, room);
+    for (int i = 0; i < n; i++) {
+        int tail = (channel->pending_head + channel->pending_count) % PENDING_MOVES;
+        channel->pending[tail] = buf[i];
+        channel->pending_count++;
     }
-    if (mov > 7) {
-        writer_lock(sync);
-        gs->players[player_idx].invalids++;
-        writer_unlock(sync);
+    if (closed && !move_ring_has_data(channel->ring)) {
+        channel->eof = true;
+        unwatch_channel(channel, loop);
+    }
+    return n;
+}
+
+// In-process strategies (-p lib:...): one pool and one completion eventfd for every instance
+static thread_pool_t* strategy_pool = NULL;
+static int strategy_notify_fd = -1;
+
+static void grant_move(sync_t* sync, player_channel_t* channel, int player_idx) {
+    if (channel->inproc != NULL) {
+        inproc_grant(channel->inproc, strategy_pool);
+    } else if (uses_ring(channel)) {
+        move_ring_grant_credit(channel->ring);
+    } else {
         sem_post(&sync->move_signal[player_idx]);
-        return;
     }
+}
 
-    writer_lock(sync);
-    int new_x = gs->players[player_idx].x + DIRS[mov][0];
-    int new_y = gs->players[player_idx].y + DIRS[mov][1];
-    writer_unlock(sync);
+static bool cell_claimed(const round_commit_t* commits, int count, int x, int y) {
+    for (int i = 0; i < count; i++) {
+        if (commits[i].valid && commits[i].x == x && commits[i].y == y) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    reader_lock(sync);
-    bool update = is_valid_move(player_idx, new_x, new_y, gs);
-    reader_unlock(sync);
+// Journals what the master did to a player that is not a move: the head stays where it is
+static void append_penalty(move_journal_t* journal, const game_state_t* gs, int player, unsigned char kind) {
+    const player_t* p = &gs->players[player];
+    journal_entry_t entry = {
+        .player = (unsigned char)player, .valid = false, .kind = kind,
+        .from_x = p->x, .from_y = p->y, .to_x = (short)p->x, .to_y = (short)p->y,
+    };
+    journal_append(journal, &entry);
+}
+
+// (x, y) was just taken: each of its neighbours has one free neighbour less
+static void take_mobility(const game_state_t* gs, uint8_t* mobility, int x, int y) {
+    for (int k = 0; k < 8; k++) {
+        int nx = x + DIRS[k][0];
+        int ny = y + DIRS[k][1];
+        if (in_bounds(gs, nx, ny)) {
+            mobility[(size_t)ny * gs->width + (size_t)nx]--;
+        }
+    }
+}
+
+int commit_round(game_state_t* gs, sync_t* sync, move_journal_t* journal, uint8_t* mobility, player_channel_t channels[], int num_players,
+                 int start_player) {
+    round_commit_t commits[MAX_PLAYERS];
+    int count = 0;
+    bool newly_blocked[MAX_PLAYERS] = { false };
+    bool any_blocked = false;
+    // MOVE_PLAN_CONT is only part of the protocol with a credit window: at -k 1
+    // every byte > 7 is an invalid move, as it always was
+    bool pipelined = sync->move_credits > 1;
+
+    // Plan: one move per player, validated against the master's own view of
+    // the board plus the cells already claimed earlier in this round.
+    for (int j = 0; j < num_players; j++) {
+        int player_idx = (start_player + j) % num_players;
+        player_channel_t* channel = &channels[player_idx];
+        if (channel->blocked) {
+            continue;
+        }
+        unsigned char mov = 0;
+        bool has_move = false;
+        while (channel->pending_count > 0 && !has_move) {
+            mov = channel->pending[channel->pending_head];
+            channel->pending_head = (channel->pending_head + 1) % PENDING_MOVES;
+            channel->pending_count--;
+            if (pipelined && (mov & MOVE_PLAN_CONT) && channel->plan_broken) {
+                grant_move(sync, channel, player_idx);
+            } else {
+                channel->plan_broken = false;
+                has_move = true;
+            }
+        }
+        if (!has_move) {
+            if (channel->eof) {
+                channel->blocked = true;
+                newly_blocked[player_idx] = true;
+                any_blocked = true;
+            }
+            continue;
+        }
 
+        unsigned char dir = pipelined ? (unsigned char)(mov & ~MOVE_PLAN_CONT) : mov;
+        round_commit_t* c = &commits[count++];
+        c->player = player_idx;
+        c->valid = false;
+        c->x = gs->players[player_idx].x;
+        c->y = gs->players[player_idx].y;
+        if (dir <= 7) {
+            c->x = gs->players[player_idx].x + DIRS[dir][0];
+            c->y = gs->players[player_idx].y + DIRS[dir][1];
+            c->valid = is_valid_move(player_idx, c->x, c->y, gs) && !cell_claimed(commits, count - 1, c->x, c->y);
+        }
+        channel->plan_broken = !c->valid;
+    }
+
+    if (count == 0 && !any_blocked) {
+        return 0;
+    }
+
+    int applied = 0;
     writer_lock(sync);
-    if (update) {
-        gs->players[player_idx].x = new_x;
-        gs->players[player_idx].y = new_y;
-        gs->players[player_idx].score += gs->board[new_x + new_y * gs->width];
-        gs->players[player_idx].valids++;
-        gs->board[new_x + new_y * gs->width] = -player_idx;
-        *last_successful_move_time = time(NULL);
-    } else {
-        gs->players[player_idx].invalids++;
+    for (int i = 0; i < count; i++) {
+        const round_commit_t* c = &commits[i];
+        player_t* p = &gs->players[c->player];
+        journal_entry_t entry = {
+            .player = (unsigned char)c->player, .valid = c->valid,
+            .from_x = p->x, .from_y = p->y, .to_x = (short)c->x, .to_y = (short)c->y,
+        };
+        if (c->valid) {
+            entry.value = (signed char)get_cell(gs, c->x, c->y);
+            p->x = c->x;
+            p->y = c->y;
+            p->score += get_cell(gs, c->x, c->y);
+            p->valids++;
+            set_cell(gs, c->x, c->y, -c->player);
+            take_mobility(gs, mobility, c->x, c->y);
+            applied++;
+        } else {
+            p->invalids++;
+        }
+        journal_append(journal, &entry);
+    }
+    for (int i = 0; i < num_players; i++) {
+        if (newly_blocked[i]) {
+            append_penalty(journal, gs, i, JOURNAL_BLOCK); // closed pipe: free cells do not matter
+        }
+    }
+    // A head with no free neighbour can never move again (cells are never freed)
+    for (int i = 0; i < num_players; i++) {
+        if (!channels[i].blocked && mobility[(size_t)gs->players[i].y * gs->width + gs->players[i].x] == 0) {
+            channels[i].blocked = true;
+            newly_blocked[i] = true;
+        }
+        if (newly_blocked[i]) {
+            gs->players[i].blocked = true;
+        }
     }
     writer_unlock(sync);
 
-    sem_post(&sync->move_signal[player_idx]);
+    for (int i = 0; i < count; i++) {
+        grant_move(sync, &channels[commits[i].player], commits[i].player);
+    }
+    return applied;
 }
 
-void check_timeout_and_finish(game_state_t* gs, sync_t* sync, const args_t* args, time_t last_successful_move_time) {
+void check_timeout_and_finish(game_state_t* gs, sync_t* sync, const args_t* args, long long last_successful_move_ms, long long now_ms) {
     reader_lock(sync);
     bool is_finished = gs->finished;
     reader_unlock(sync);
@@ -95,33 +253,43 @@ void check_timeout_and_finish(game_state_t* gs, sync_t* sync, const args_t* args
         return;
     }
 
-    if (difftime(time(NULL), last_successful_move_time) > args->timeout) {
+    if (now_ms - last_successful_move_ms >= (long long)args->timeout * 1000) {
         writer_lock(sync);
         gs->finished = true;
         writer_unlock(sync);
     }
 }
 
-void check_all_blocked_and_finish(game_state_t* gs, sync_t* sync) {
-    reader_lock(sync);
-    bool is_finished = gs->finished;
-    reader_unlock(sync);
+void check_move_limit_and_finish(game_state_t* gs, sync_t* sync, const args_t* args, int num_players) {
+    if (gs->finished || args->max_moves == 0) {
+        return;
+    }
 
-    if (is_finished) {
+    unsigned long valids = 0;
+    for (int i = 0; i < num_players; i++) {
+        valids += gs->players[i].valids;
+    }
+
+    if (valids >= args->max_moves) {
+        writer_lock(sync);
+        gs->finished = true;
+        writer_unlock(sync);
+    }
+}
+
+void check_all_blocked_and_finish(game_state_t* gs, sync_t* sync, const player_channel_t channels[], int num_players) {
+    if (gs->finished) {
         return;
     }
 
     int blocked = 0;
-    reader_lock(sync);
-    unsigned int num_players = gs->num_players;
-    for (unsigned i = 0; i < num_players; i++) {
-        if (gs->players[i].blocked) {
+    for (int i = 0; i < num_players; i++) {
+        if (channels[i].blocked) {
             blocked++;
         }
     }
-    reader_unlock(sync);
 
-    if (blocked == (int)num_players) {
+    if (blocked == num_players) {
         writer_lock(sync);
         gs->finished = true;
         writer_unlock(sync);
@@ -132,17 +300,28 @@ static void update_view(game_state_t* gs, sync_t* sync, const args_t* args) {
     if (args->view_path == NULL) {
         return;
     }
+    if (args->async_view) {
+        publish_view_frame(sync); // the view paces itself with -d
+        return;
+    }
     sem_post(&sync->drawing_signal);
     sem_wait(&sync->not_drawing_signal);
-    reader_lock(sync);
+    // Only the master writes gs->finished, and the pause needs no lock: players keep
+    // reading and sending moves while the frame is on screen
     if (!gs->finished) {
         struct timespec ts = { .tv_sec = args->delay / 1000, .tv_nsec = (args->delay % 1000) * 1000000L };
         nanosleep(&ts, NULL);
     }
-    reader_unlock(sync);
 }
 
-void print_winners(game_state_t* gs) {
+static int copy_winners(int* out, const int* winners, int count) {
+    if (out != NULL) {
+        memcpy(out, winners, (size_t)count * sizeof(int));
+    }
+    return count;
+}
+
+int print_winners(game_state_t* gs, int winners[]) {
     unsigned int best_score = 0;
     int best_players[MAX_PLAYERS], count = 0;
 
@@ -158,7 +337,7 @@ void print_winners(game_state_t* gs) {
 
     if (count == 1) {
         printf("Winner: %s (Score: %u)\n", gs->players[best_players[0]].name, gs->players[best_players[0]].score);
-        return;
+        return copy_winners(winners, best_players, 1);
     }
 
     unsigned int min_valids = UINT_MAX;
@@ -178,7 +357,7 @@ void print_winners(game_state_t* gs) {
                gs->players[tied_by_valids[0]].name,
                gs->players[tied_by_valids[0]].score,
                gs->players[tied_by_valids[0]].valids);
-        return;
+        return copy_winners(winners, tied_by_valids, 1);
     }
 
     unsigned int min_invalids = UINT_MAX;
@@ -202,7 +381,7 @@ void print_winners(game_state_t* gs) {
                gs->players[final_winners[0]].score,
                gs->players[final_winners[0]].valids,
                gs->players[final_winners[0]].invalids);
-        return;
+        return copy_winners(winners, final_winners, 1);
     }
 
     printf("Tie between:\n");
@@ -214,69 +393,35 @@ void print_winners(game_state_t* gs) {
                gs->players[idx].valids,
                gs->players[idx].invalids);
     }
+    return copy_winners(winners, final_winners, final_count);
 }
 
-void wait_all(game_state_t* gs, pid_t view) {
-    int remaining = (int)gs->num_players + ((view != -1) ? 1 : 0);
-    int status;
-
-    bool hold_player_prints = (view != -1);
-    int buf_idx[MAX_PLAYERS];
-    int buf_exit[MAX_PLAYERS];
-    int buf_count = 0;
-
-    while (remaining > 0) {
-        pid_t pid = wait(&status);
-        if (pid == -1) {
-            if (errno == EINTR) {
-                continue;
-            }
-            break;
-        }
-        remaining--;
-
-        int exit_code = 0;
-        if (WIFEXITED(status)) {
-            exit_code = WEXITSTATUS(status);
-        } else if (WIFSIGNALED(status)) {
-            exit_code = 128 + WTERMSIG(status);
-        }
-
-        if (view != -1 && pid == view) {
-            printf("View exited (%d)\n", exit_code);
-            fflush(stdout);
-            hold_player_prints = false;
-            for (int b = 0; b < buf_count; ++b) {
-                int idx = buf_idx[b];
-                print_player_exit(gs, idx, buf_exit[b]);
-            }
-            buf_count = 0;
-            continue;
-        }
-
-        int idx = -1;
-        bool found = false;
-        for (unsigned int i = 0; i < gs->num_players && !found; i++) {
-            if (gs->players[i].pid == pid) {
-                idx = (int)i;
-                found = true;
-            }
-        }
+static int exit_code_of(int status) {
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    }
+    if (WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
+    }
+    return 0;
+}
 
-        if (idx >= 0) {
-            if (hold_player_prints) {
-                if (buf_count < MAX_PLAYERS) {
-                    buf_idx[buf_count] = idx;
-                    buf_exit[buf_count] = exit_code;
-                    buf_count++;
-                } else {
-                    print_player_exit(gs, idx, exit_code);
-                }
-            } else {
-                print_player_exit(gs, idx, exit_code);
-            }
-        }
+// Reaps a child without blocking: 1 once it exited, 0 while it runs, -1 if it cannot be waited for
+static int reap_child(pid_t pid, int* status, struct rusage* usage) {
+    pid_t r;
+    while ((r = wait4(pid, status, WNOHANG, usage)) == -1 && errno == EINTR) {
     }
+    return (r == pid) ? 1 : (r == 0) ? 0 : -1;
+}
+
+static int pidfd_open_child(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
 }
 
 void set_valid_positions(game_state_t* gs, int player_pos) {
@@ -316,14 +461,12 @@ void set_valid_positions(game_state_t* gs, int player_pos) {
         y = gs->height - 1;
     }
 
-    int idx = x + y * gs->width;
-    if (!is_free_cell(gs->board[idx])) {
+    if (!is_free_cell(get_cell(gs, x, y))) {
         bool placed = false;
         for (int offset = 0; offset < gs->width * gs->height && !placed; offset++) {
             int xx = (x + offset) % gs->width;
             int yy = (y + (x + offset) / gs->width) % gs->height;
-            int id = xx + yy * gs->width;
-            if (is_free_cell(gs->board[id])) {
+            if (is_free_cell(get_cell(gs, xx, yy))) {
                 x = xx;
                 y = yy;
                 placed = true;
@@ -333,12 +476,14 @@ void set_valid_positions(game_state_t* gs, int player_pos) {
 
     gs->players[player_pos].x = x;
     gs->players[player_pos].y = y;
-    gs->board[x + y * gs->width] = -player_pos;
+    set_cell(gs, x, y, -player_pos);
 }
 
-void close_fds(int fds[][2], int num_players) {
+void close_fds(player_channel_t channels[], int num_players) {
     for (int i = 0; i < num_players; i++) {
-        close(fds[i][0]);
+        if (channels[i].fd >= 0) {
+            close(channels[i].fd);
+        }
     }
 }
 
@@ -349,6 +494,20 @@ void initialize_default_args(args_t* args) {
     args->timeout = TIMEOUT_DEFAULT;
     args->seed = (unsigned int)time(NULL);
     args->view_path = NULL;
+    args->record_path = NULL;
+    args->stats_path = NULL;
+    args->backend = EVENT_BACKEND_EPOLL;
+    args->transport = TRANSPORT_PIPE;
+    args->rw_policy = RW_POLICY_FIFO;
+    args->credits = 1;
+    args->games = 1;
+    args->reuse = false;
+    args->instances = 1;
+    args->think_ms = 0;
+    args->overrun_blocks = false;
+    args->max_moves = 0;
+    args->async_view = false;
+    args->layout = BOARD_LAYOUT_V1;
     for (int i = 0; i < MAX_PLAYERS; i++) {
         args->player_paths[i] = NULL;
     }
@@ -361,8 +520,10 @@ void init_game_state(game_state_t* gs, args_t* args, int num_players) {
     gs->finished = false;
 
     srand(args->seed);
-    for (int i = 0; i < args->height * args->width; i++) {
-        gs->board[i] = ((rand() % MAX_BOARD_VALUE) + MIN_BOARD_VALUE);
+    for (int y = 0; y < args->height; y++) {
+        for (int x = 0; x < args->width; x++) {
+            set_cell(gs, x, y, (rand() % MAX_BOARD_VALUE) + MIN_BOARD_VALUE);
+        }
     }
 
     for (int i = 0; i < num_players; i++) {
@@ -370,13 +531,31 @@ void init_game_state(game_state_t* gs, args_t* args, int num_players) {
         gs->players[i].invalids = 0;
         
         const char* full_path = args->player_paths[i];
-        const char* executable_name = strrchr(full_path, '/');
+        // In-process players are named after their strategy symbol, if one was given
+        const char* executable_name = NULL;
+        if (is_inproc_spec(full_path)) {
+            const char* symbol = strrchr(full_path, ':');
+            if (symbol != full_path + strlen(INPROC_PREFIX) - 1) {
+                executable_name = symbol;
+            }
+        }
+        if (executable_name == NULL) {
+            executable_name = strrchr(full_path, '/');
+        }
         if (executable_name != NULL) {
             executable_name++;
         } else {
             executable_name = full_path;
         }
-        snprintf(gs->players[i].name, sizeof(gs->players[i].name), "%s - P%d", executable_name, i + 1);
+        // choose_best_move_<strategy>: the strategy alone tells the players apart
+        if (strncmp(executable_name, INPROC_DEFAULT_SYMBOL "_", strlen(INPROC_DEFAULT_SYMBOL) + 1) == 0) {
+            executable_name += strlen(INPROC_DEFAULT_SYMBOL) + 1;
+        }
+        // Long names are cut before the " - P<n>" suffix, which keeps every name unique
+        char suffix[8];
+        int suffix_len = snprintf(suffix, sizeof(suffix), " - P%d", i + 1);
+        snprintf(gs->players[i].name, sizeof(gs->players[i].name), "%.*s%s",
+                 (int)sizeof(gs->players[i].name) - 1 - suffix_len, executable_name, suffix);
         
         gs->players[i].score = 0;
         gs->players[i].valids = 0;
@@ -384,7 +563,7 @@ void init_game_state(game_state_t* gs, args_t* args, int num_players) {
     }
 }
 
-pid_t create_view_process(const char* view_path, const char* width_s, const char* height_s) {
+pid_t create_view_process(const char* view_path, const char* width_s, const char* height_s, char* const envp[]) {
     pid_t pid = fork();
     if (pid < 0) {
         perror("fork v");
@@ -393,7 +572,7 @@ pid_t create_view_process(const char* view_path, const char* width_s, const char
 
     if (pid == 0) {
         char *argv[] = { (char*)view_path, (char*)width_s, (char*)height_s, NULL };
-        execve(view_path, argv, NULL);
+        execve(view_path, argv, envp);
         perror("exec view");
         _exit(1);
     }
@@ -401,7 +580,7 @@ pid_t create_view_process(const char* view_path, const char* width_s, const char
     return pid;
 }
 
-pid_t create_player_process(const char* player_path, const char* width_s, const char* height_s, int pipe_fd[2]) {
+pid_t create_player_process(const char* player_path, const char* width_s, const char* height_s, int pipe_fd[2], char* const envp[]) {
     pid_t pid = fork();
     if (pid < 0) {
         perror("fork player");
@@ -415,7 +594,7 @@ pid_t create_player_process(const char* player_path, const char* width_s, const
         close(pipe_fd[0]);
         close(pipe_fd[1]);
         char *argv[] = { (char*)player_path, (char*)width_s, (char*)height_s, NULL };
-        execve(player_path, argv, NULL);
+        execve(player_path, argv, envp);
         perror("exec player");
         _exit(1);
     }
@@ -428,42 +607,947 @@ void start_view (sync_t* sync) {
     sem_wait(&sync->not_drawing_signal);
 }
 
-void play(game_state_t* gs, sync_t* sync, const args_t* args, int fds[][2], int num_players, int max_fd) {
-    time_t last_successful_move_time = time(NULL);
-    fd_set read_fds;
-    bool is_player_blocked;
-    int start_player = 0;
+void release_players(sync_t* sync, player_channel_t channels[], int num_players) {
+    for (int i = 0; i < num_players; i++) {
+        if (channels[i].inproc != NULL) {
+            inproc_release(channels[i].inproc); // nothing parks on a credit: the last request just completes
+        } else if (!channels[i].eof) {
+            grant_move(sync, &channels[i], i);
+        }
+    }
+}
+
+static void discard_pipe(player_channel_t* channel) {
+    unsigned char buf[PENDING_MOVES];
+    ssize_t n;
+    while ((n = read(channel->fd, buf, sizeof(buf))) > 0 || (n == -1 && errno == EINTR)) {
+    }
+    if (n == 0) {
+        channel->eof = true;
+    }
+}
+
+void start_next_game(game_state_t* gs, sync_t* sync, args_t* args, player_channel_t channels[], int num_players, move_rings_t* rings,
+                     move_journal_t* journal) {
+    writer_lock(sync);
+    init_game_state(gs, args, num_players);
+    journal_new_game(journal);
+    for (int i = 0; i < num_players; i++) {
+        if (channels[i].inproc != NULL) {
+            channels[i].eof = false; // giving up ends a game, not the strategy
+        }
+        channels[i].blocked = channels[i].eof;
+        channels[i].pending_head = 0;
+        channels[i].pending_count = 0;
+        channels[i].plan_broken = false;
+        channels[i].awaiting = false;
+        gs->players[i].blocked = channels[i].eof;
+
+        // Back to a full credit window; the player is parked on game_generation
+        while (sem_trywait(&sync->move_signal[i]) == 0) {
+        }
+        for (unsigned int c = 0; c < sync->move_credits; c++) {
+            sem_post(&sync->move_signal[i]);
+        }
+        if (rings != NULL) {
+            __atomic_store_n(&rings->rings[i].credits, sync->move_credits, __ATOMIC_RELEASE);
+        }
+    }
+    writer_unlock(sync);
+
+    for (int i = 0; i < num_players; i++) {
+        if (channels[i].inproc != NULL) {
+            inproc_bind(channels[i].inproc, gs, sync, journal, i, strategy_notify_fd);
+            inproc_grant(channels[i].inproc, strategy_pool);
+        }
+    }
+
+    __atomic_add_fetch(&sync->game_generation, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&sync->game_generation, INT_MAX);
+}
+
+void stop_reused_players(sync_t* sync) {
+    __atomic_store_n(&sync->players_shutdown, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&sync->game_generation, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&sync->game_generation, INT_MAX);
+}
+
+static void print_standings(const game_state_t* gs, const standing_t standings[], int num_players, unsigned int games) {
+    printf("Standings after %u games:\n", games);
+    printf("%-16s %6s %10s %8s %8s\n", "Player", "Wins", "Score", "Valids", "Invalids");
+    for (int i = 0; i < num_players; i++) {
+        printf("%-16s %6u %10llu %8llu %8llu\n",
+               gs->players[i].name,
+               standings[i].wins,
+               standings[i].score,
+               standings[i].valids,
+               standings[i].invalids);
+    }
+    fflush(stdout);
+}
+
+static game_instance_t* teardown_instances = NULL;
+static int teardown_count = 0;
+
+static void teardown_instances_now(void) {
+    // Async-signal-safe: only kill() and shm_unlink() on precomputed names
+    for (int k = 0; k < teardown_count; k++) {
+        game_instance_t* inst = &teardown_instances[k];
+        if (inst->players_running && inst->gs != NULL) {
+            for (unsigned int i = 0; i < inst->gs->num_players; i++) {
+                if (inst->gs->players[i].pid > 0) {
+                    kill(inst->gs->players[i].pid, SIGKILL);
+                }
+            }
+        }
+        if (inst->view > 0) {
+            kill(inst->view, SIGKILL);
+        }
+        for (int s = 0; s < INSTANCE_SEGMENTS; s++) {
+            shm_unlink(inst->shm_names[s]);
+        }
+    }
+    teardown_count = 0;
+}
+
+static void on_fatal_signal(int sig) {
+    teardown_instances_now();
+    raise(sig); // SA_RESETHAND: default action (exit / core dump) from here
+}
+
+static void install_teardown(game_instance_t instances[], int num_instances) {
+    teardown_instances = instances;
+    teardown_count = num_instances;
+    atexit(teardown_instances_now);
+
+    static const int signals[] = { SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGSEGV, SIGBUS, SIGFPE, SIGABRT };
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_fatal_signal;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        sigaction(signals[i], &sa, NULL);
+    }
+}
+
+static int setup_instance(game_instance_t* inst, int index, int num_instances, const args_t* args) {
+    memset(inst, 0, sizeof(*inst));
+    inst->index = index;
+    inst->view = -1;
+    // -j 1 keeps the historical segment names
+    if (num_instances > 1) {
+        snprintf(inst->shm_instance, sizeof(inst->shm_instance), "%d_%d", (int)getpid(), index);
+    }
+    snprintf(inst->env_entry, sizeof(inst->env_entry), "%s=%s", SHM_INSTANCE_ENV, inst->shm_instance);
+    inst->envp[0] = inst->env_entry;
+    int env_count = 1;
+    for (char** e = environ; *e != NULL && env_count <= ENV_FORWARD_MAX; e++) {
+        if (strncmp(*e, ENV_FORWARD_PREFIX, strlen(ENV_FORWARD_PREFIX)) == 0 &&
+            strncmp(*e, SHM_INSTANCE_ENV "=", strlen(SHM_INSTANCE_ENV) + 1) != 0) {
+            inst->envp[env_count++] = *e;
+        }
+    }
+    inst->envp[env_count] = NULL;
+
+    shm_set_instance(inst->shm_instance);
+    shm_name(inst->shm_names[0], SHM_NAME_LEN, SHM_STATE);
+    shm_name(inst->shm_names[1], SHM_NAME_LEN, SHM_SYNC);
+    shm_name(inst->shm_names[2], SHM_NAME_LEN, SHM_MOVES);
+    shm_name(inst->shm_names[3], SHM_NAME_LEN, SHM_JOURNAL);
+
+    inst->gs = allocate_game_state_shm(args->width, args->height, args->layout);
+    if (inst->gs == NULL) {
+        fprintf(stderr, "Failed to allocate game state shared memory\n");
+        return -1;
+    }
+    inst->sync = allocate_sync_shm();
+    if (inst->sync == NULL) {
+        fprintf(stderr, "Failed to allocate sync shared memory\n");
+        return -1;
+    }
+    inst->journal = allocate_journal_shm();
+    if (inst->journal == NULL) {
+        fprintf(stderr, "Failed to allocate move journal shared memory\n");
+        return -1;
+    }
+    inst->mobility = malloc((size_t)args->width * args->height);
+    inst->mobility_scratch = malloc(FREE_NEIGHBOR_SCRATCH(args->width));
+    if (inst->mobility == NULL || inst->mobility_scratch == NULL) {
+        perror("malloc mobility map");
+        return -1;
+    }
+    for (int i = 0; i < MAX_PLAYERS && args->player_paths[i] != NULL; i++) {
+        if (is_inproc_spec(args->player_paths[i]) && inproc_load(&inst->inproc[i], args->player_paths[i]) == -1) {
+            return -1;
+        }
+    }
+    if (args->transport == TRANSPORT_RING) {
+        inst->rings = allocate_move_rings_shm(args->credits);
+        if (inst->rings == NULL) {
+            fprintf(stderr, "Failed to allocate move rings shared memory\n");
+            return -1;
+        }
+    } else {
+        cleanup_move_rings_shm(); // a stale segment must not lure players away from their pipes
+    }
+    if (args->record_path != NULL) {
+        inst->recorder = recorder_open(args->record_path);
+        if (inst->recorder == NULL) {
+            fprintf(stderr, "Failed to create the recording %s\n", args->record_path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void cleanup_instance(game_instance_t* inst) {
+    if (recorder_close(inst->recorder) == -1) {
+        fprintf(stderr, "Failed to write the recording\n");
+    }
+    inst->recorder = NULL;
+    free(inst->stats.rtt_us);
+    inst->stats.rtt_us = NULL;
+    free(inst->mobility);
+    free(inst->mobility_scratch);
+    inst->mobility = NULL;
+    inst->mobility_scratch = NULL;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        inproc_unload(&inst->inproc[i]);
+    }
+    shm_set_instance(inst->shm_instance);
+    cleanup_shared_memory();
+    cleanup_journal_shm();
+    if (inst->rings != NULL) {
+        cleanup_move_rings_shm();
+    }
+}
+
+static void spawn_players(game_instance_t* inst, const args_t* args, int num_players, const char* width_s, const char* height_s) {
+    for (int i = 0; i < num_players; i++) {
+        player_channel_t* channel = &inst->channels[i];
+        channel->blocked = false;
+        channel->eof = false;
+        channel->in_loop = false;
+        channel->pending_head = 0;
+        channel->pending_count = 0;
+        channel->plan_broken = false;
+        channel->awaiting = false;
+        if (is_inproc_spec(args->player_paths[i])) {
+            inst->gs->players[i].pid = 0;
+            channel->fd = -1;
+            channel->ring = NULL;
+            channel->inproc = &inst->inproc[i];
+            inproc_bind(channel->inproc, inst->gs, inst->sync, inst->journal, i, strategy_notify_fd);
+            continue;
+        }
+
+        int pipe_fd[2];
+        if (pipe(pipe_fd) == -1) {
+            perror("pipe");
+            exit(1);
+        }
+        pid_t pid_p = create_player_process(args->player_paths[i], width_s, height_s, pipe_fd, inst->envp);
+        if (pid_p < 0) {
+            fprintf(stderr, "Failed to create player process %d\n", i);
+            exit(1);
+        }
+        inst->gs->players[i].pid = pid_p;
+        channel->fd = pipe_fd[0];
+        channel->ring = (inst->rings != NULL) ? &inst->rings->rings[i] : NULL;
+        channel->inproc = NULL;
+        if (fcntl(channel->fd, F_SETFL, O_NONBLOCK) == -1) {
+            perror("fcntl");
+            exit(1);
+        }
+    }
+}
+
+static void watch_channels(game_instance_t* inst, int num_players, event_loop_t* loop) {
+    for (int i = 0; i < num_players; i++) {
+        player_channel_t* channel = &inst->channels[i];
+        if (channel->inproc == NULL && !channel->eof && !channel->in_loop) {
+            if (event_loop_add(loop, channel->fd, inst->index * MAX_PLAYERS + i) == -1) {
+                perror("event_loop_add");
+                exit(1);
+            }
+            channel->in_loop = true;
+        }
+    }
+}
+
+static void stats_begin_game(game_instance_t* inst, unsigned int seed) {
+    game_stats_t* stats = &inst->stats;
+    stats->seed = seed;
+    stats->start_us = monotonic_us();
+    stats->first_seq = journal_head(inst->journal);
+    stats->rtt_count = 0;
+    stats->overruns = 0;
+    memset(stats->rss_kb, 0, sizeof(stats->rss_kb));
+}
+
+static void stats_add_rtt(game_stats_t* stats, long long us) {
+    if (stats->rtt_count == stats->rtt_capacity) {
+        size_t capacity = (stats->rtt_capacity > 0) ? stats->rtt_capacity * 2 : 1024;
+        uint32_t* grown = realloc(stats->rtt_us, capacity * sizeof(uint32_t));
+        if (grown == NULL) {
+            return; // statistics only: drop the sample
+        }
+        stats->rtt_us = grown;
+        stats->rtt_capacity = capacity;
+    }
+    stats->rtt_us[stats->rtt_count++] = (us > (long long)UINT32_MAX) ? UINT32_MAX : (uint32_t)us;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t* sorted, size_t count, size_t pct) {
+    return (count == 0) ? 0 : sorted[(count - 1) * pct / 100];
+}
+
+static void write_game_stats(game_instance_t* inst, const args_t* args, int num_players, double wall_ms) {
+    FILE* f = fopen(args->stats_path, "a");
+    if (f == NULL) {
+        perror("fopen stats");
+        return;
+    }
+    game_stats_t* stats = &inst->stats;
+    qsort(stats->rtt_us, stats->rtt_count, sizeof(uint32_t), compare_u32);
+    unsigned int moves = journal_head(inst->journal) - stats->first_seq;
+    unsigned long valids = 0;
+    for (int i = 0; i < num_players; i++) {
+        valids += inst->gs->players[i].valids;
+    }
+    struct rusage self;
+    getrusage(RUSAGE_SELF, &self);
+
+    fprintf(f, "instance=%d game=%u seed=%u width=%u height=%u players=%d moves=%u valids=%lu wall_ms=%.3f "
+               "moves_per_s=%.0f rtt_samples=%zu rtt_p50_us=%u rtt_p99_us=%u overruns=%u rss_master_kb=%ld rss_players_kb=",
+            inst->index, inst->games_played + 1, stats->seed, inst->gs->width, inst->gs->height, num_players, moves,
+            valids, wall_ms, (wall_ms > 0) ? moves * 1000.0 / wall_ms : 0.0, stats->rtt_count,
+            percentile(stats->rtt_us, stats->rtt_count, 50), percentile(stats->rtt_us, stats->rtt_count, 99),
+            stats->overruns, self.ru_maxrss);
+    for (int i = 0; i < num_players; i++) {
+        fprintf(f, "%s%ld", (i > 0) ? "," : "", stats->rss_kb[i]);
+    }
+    fprintf(f, "\n");
+    if (fclose(f) != 0) {
+        perror("fclose stats");
+    }
+}
+
+static void begin_game(game_instance_t* inst, const args_t* args, int num_instances, int num_players,
+                       event_loop_t* loop, const char* width_s, const char* height_s) {
+    args_t game_args = *args;
+    game_args.seed = args->seed + inst->games_played * (unsigned int)num_instances + (unsigned int)inst->index;
+
+    if (!inst->players_running) {
+        init_game_state(inst->gs, &game_args, num_players);
+        journal_new_game(inst->journal);
+        init_sync(inst->sync, args->rw_policy);
+        set_move_credits(inst->sync, args->credits);
+        inst->sync->view_async = args->async_view;
+        inst->sync->view_frame_ms = (args->delay > 0) ? (unsigned int)args->delay : 0;
+        inst->sync->players_reused = args->reuse;
+        if (inst->rings != NULL) {
+            init_move_rings(inst->rings, args->credits);
+        }
+        spawn_players(inst, args, num_players, width_s, height_s);
+        for (int i = 0; i < num_players; i++) {
+            if (inst->channels[i].inproc != NULL) {
+                inproc_grant(inst->channels[i].inproc, strategy_pool); // the initial move_signal permit
+            }
+        }
+        inst->players_running = true;
+    } else {
+        start_next_game(inst->gs, inst->sync, &game_args, inst->channels, num_players, inst->rings, inst->journal);
+    }
+    // Players are placed: from here on only commit_round() takes cells
+    free_neighbor_map(inst->gs, inst->mobility, inst->mobility_scratch, 0, inst->gs->height);
+    if (inst->recorder != NULL) {
+        record_game(inst->recorder, inst->gs, inst->journal, game_args.seed);
+    }
+    if (args->stats_path != NULL) {
+        stats_begin_game(inst, game_args.seed);
+    }
+    watch_channels(inst, num_players, loop);
 
     if (args->view_path != NULL) {
-        start_view(sync);
+        inst->view = create_view_process(args->view_path, width_s, height_s, inst->envp);
+    }
+    if (num_instances > 1) {
+        printf("Instance %d, game %u/%u (seed %u)\n", inst->index, inst->games_played + 1, args->games, game_args.seed);
+        fflush(stdout);
+    } else if (args->games > 1) {
+        printf("Game %u/%u (seed %u)\n", inst->games_played + 1, args->games, game_args.seed);
+        fflush(stdout);
+    }
+
+    if (args->view_path != NULL && !args->async_view) {
+        start_view(inst->sync);
     }
+    inst->last_successful_move_ms = monotonic_ms();
+    inst->start_player = 0;
+    inst->pending = false;
+}
 
-    do {
-        prepare_fd_set(&read_fds, gs, fds, num_players, start_player, sync);
+// Watches a child's exit on the event loop; without a pidfd (old kernel) the teardown polls it
+static void watch_exit(game_instance_t* inst, int slot, pid_t pid, event_loop_t* loop) {
+    teardown_t* td = &inst->teardown;
+    td->waiting[slot] = true;
+    td->pidfds[slot] = pidfd_open_child(pid);
+    if (td->pidfds[slot] != -1 && event_loop_add(loop, td->pidfds[slot], EXIT_TAG + inst->index * EXIT_SLOTS + slot) == -1) {
+        close(td->pidfds[slot]);
+        td->pidfds[slot] = -1;
+    }
+}
 
-        int ready = select(max_fd + 1, &read_fds, NULL, NULL, NULL);
-        if (ready == -1) {
-            perror("select");
-            break;
+static void unwatch_exit(teardown_t* td, int slot, event_loop_t* loop) {
+    td->waiting[slot] = false;
+    if (td->pidfds[slot] != -1) {
+        event_loop_remove(loop, td->pidfds[slot]);
+        close(td->pidfds[slot]);
+        td->pidfds[slot] = -1;
+    }
+}
+
+static void begin_teardown(game_instance_t* inst, const args_t* args, int num_players, event_loop_t* loop) {
+    teardown_t* td = &inst->teardown;
+    long long now_ms = monotonic_ms();
+
+    inst->stats.end_us = monotonic_us();
+    if (inst->recorder != NULL) {
+        record_end(inst->recorder, inst->gs);
+    }
+    release_players(inst->sync, inst->channels, num_players);
+
+    memset(td, 0, sizeof(*td));
+    td->active = true;
+    td->reuse = args->reuse && inst->games_played + 1 < args->games;
+    td->view_deadline_ms = now_ms + VIEW_EXIT_GRACE_MS;
+    // Going idle does not wait for the view; exiting does
+    td->players_deadline_ms = td->reuse ? now_ms + PLAYER_EXIT_GRACE_MS : LLONG_MAX;
+    for (int slot = 0; slot < EXIT_SLOTS; slot++) {
+        td->pidfds[slot] = -1;
+    }
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        td->exit_codes[i] = -1;
+    }
+
+    if (inst->view != -1) {
+        watch_exit(inst, VIEW_SLOT, inst->view, loop);
+    }
+    if (args->reuse && !td->reuse) {
+        stop_reused_players(inst->sync);
+    }
+    for (int i = 0; i < num_players; i++) {
+        if (td->reuse || inst->gs->players[i].pid <= 0) {
+            td->waiting[i] = true; // until it acknowledges the end (-r) or its last request completes (in-process)
+        } else {
+            unwatch_channel(&inst->channels[i], loop); // its exit shows on the pidfd
+            watch_exit(inst, i, inst->gs->players[i].pid, loop);
+        }
+    }
+}
+
+// -r: discards late moves and tells whether the player acknowledged the end of the game
+static bool player_idle(game_instance_t* inst, int i, event_loop_t* loop) {
+    player_channel_t* channel = &inst->channels[i];
+    discard_pipe(channel);
+    if (channel->ring != NULL) {
+        unsigned char buf[MOVE_RING_SIZE];
+        while (move_ring_pop(channel->ring, buf, MOVE_RING_SIZE) > 0) {
+        }
+    }
+    if (channel->eof) {
+        unwatch_channel(channel, loop);
+        return true;
+    }
+    return __atomic_load_n(&inst->sync->player_game_ack[i], __ATOMIC_ACQUIRE) == inst->sync->game_generation + 1;
+}
+
+// Reaps whatever exited and kills whatever ran past its grace period. Never blocks.
+// Returns true once the view is gone and every player exited (or went idle with -r).
+static bool advance_teardown(game_instance_t* inst, int num_players, event_loop_t* loop) {
+    teardown_t* td = &inst->teardown;
+    long long now_ms = monotonic_ms();
+    int status;
+    struct rusage usage;
+
+    td->poked = false;
+    td->poll = false;
+    if (td->waiting[VIEW_SLOT]) {
+        int r = reap_child(inst->view, &status, NULL);
+        if (r != 0) {
+            unwatch_exit(td, VIEW_SLOT, loop);
+            inst->view = -1;
+            if (r == 1) {
+                printf("View exited (%d)\n", exit_code_of(status));
+                fflush(stdout);
+            }
+        } else {
+            if (now_ms >= td->view_deadline_ms && !td->killed[VIEW_SLOT]) {
+                kill(inst->view, SIGKILL);
+                td->killed[VIEW_SLOT] = true;
+            }
+            td->poll = td->poll || td->pidfds[VIEW_SLOT] == -1;
+        }
+    }
+    if (!td->waiting[VIEW_SLOT] && td->players_deadline_ms == LLONG_MAX) {
+        td->players_deadline_ms = now_ms + PLAYER_EXIT_GRACE_MS;
+    }
+
+    bool expired = now_ms >= td->players_deadline_ms;
+    for (int i = 0; i < num_players; i++) {
+        player_channel_t* channel = &inst->channels[i];
+        pid_t pid = inst->gs->players[i].pid;
+        if (!td->waiting[i]) {
+            continue;
+        }
+        if (channel->inproc != NULL) {
+            td->waiting[i] = !inproc_idle(channel->inproc); // completions wake the loop on the pool's eventfd
+            td->exit_codes[i] = 0;
+        } else if (td->reuse) {
+            td->waiting[i] = !player_idle(inst, i, loop);
+            if (td->waiting[i] && expired) {
+                // Hung: it cannot take part in later games; the last game's teardown reaps it
+                kill(pid, SIGKILL);
+                channel->eof = true;
+                unwatch_channel(channel, loop);
+                td->waiting[i] = false;
+            }
+            td->poll = td->poll || td->waiting[i];
+        } else {
+            int r = reap_child(pid, &status, &usage);
+            if (r != 0) {
+                unwatch_exit(td, i, loop);
+                if (r == 1) {
+                    td->exit_codes[i] = exit_code_of(status);
+                    inst->stats.rss_kb[i] = usage.ru_maxrss;
+                }
+            } else {
+                if (expired && !td->killed[i]) {
+                    kill(pid, SIGKILL);
+                    td->killed[i] = true;
+                }
+                td->poll = td->poll || td->pidfds[i] == -1;
+            }
         }
+    }
+
+    for (int slot = 0; slot < EXIT_SLOTS; slot++) {
+        if (td->waiting[slot]) {
+            return false;
+        }
+    }
+    // The view went first, so player exits are printed after it released the terminal
+    for (int i = 0; i < num_players && !td->reuse; i++) {
+        if (td->exit_codes[i] >= 0) {
+            print_player_exit(inst->gs, i, td->exit_codes[i]);
+        }
+    }
+    td->active = false;
+    return true;
+}
+
+// Earliest time the teardown needs the loop back without a pidfd or the pool waking it
+static long long teardown_deadline_ms(const game_instance_t* inst, int num_players) {
+    const teardown_t* td = &inst->teardown;
+    long long next = LLONG_MAX;
+    if (td->poll) {
+        next = monotonic_ms() + (td->reuse ? REUSE_POLL_MS : REAP_POLL_MS);
+    }
+    if (td->waiting[VIEW_SLOT] && !td->killed[VIEW_SLOT] && td->view_deadline_ms < next) {
+        next = td->view_deadline_ms;
+    }
+    for (int i = 0; i < num_players; i++) {
+        if (td->waiting[i] && !td->killed[i] && inst->channels[i].inproc == NULL && td->players_deadline_ms < next) {
+            next = td->players_deadline_ms;
+        }
+    }
+    return next;
+}
+
+static void finish_game(game_instance_t* inst, const args_t* args, int num_players, standing_t standings[]) {
+    if (!inst->teardown.reuse) {
+        close_fds(inst->channels, num_players);
+        destroy_sync(inst->sync);
+        inst->players_running = false;
+    }
+    inst->view = -1;
+
+    int winners[MAX_PLAYERS];
+    int winner_count = print_winners(inst->gs, winners);
+    for (int i = 0; i < winner_count; i++) {
+        standings[winners[i]].wins++;
+    }
+    for (int i = 0; i < num_players; i++) {
+        standings[i].score += inst->gs->players[i].score;
+        standings[i].valids += inst->gs->players[i].valids;
+        standings[i].invalids += inst->gs->players[i].invalids;
+    }
+
+    if (args->stats_path != NULL) {
+        write_game_stats(inst, args, num_players, (double)(inst->stats.end_us - inst->stats.start_us) / 1000.0);
+    }
+    inst->games_played++;
+    inst->done = (inst->games_played == args->games);
+}
+
+static int wait_for_moves(event_loop_t* loop, game_instance_t instances[], int num_instances, int num_players, int* ready_tags, int max_tags, int deadline_in_ms) {
+    bool ready = false;
+    bool pipe_players = false;
+    int ring_instances = 0;
+    move_rings_t* rings = NULL;
+    unsigned int seen = 0;
+
+    for (int k = 0; k < num_instances; k++) {
+        game_instance_t* inst = &instances[k];
+        if (inst->done || inst->teardown.active) {
+            continue; // a teardown is woken by its pidfds and the deadline timer
+        }
+        // Moves still queued from a previous round must not wait for new input
+        ready = ready || inst->pending;
+        if (inst->rings != NULL) {
+            ring_instances++;
+            rings = inst->rings;
+            seen = move_rings_doorbell(rings);
+        }
+        for (int i = 0; i < num_players; i++) {
+            const player_channel_t* channel = &inst->channels[i];
+            if (channel->blocked || channel->eof || channel->inproc != NULL) {
+                continue;
+            }
+            if (uses_ring(channel)) {
+                ready = ready || move_ring_has_data(channel->ring) ||
+                        __atomic_load_n(&channel->ring->closed, __ATOMIC_ACQUIRE);
+            } else {
+                pipe_players = true;
+            }
+        }
+    }
+
+    if (ready) {
+        return event_loop_wait(loop, ready_tags, max_tags, 0);
+    }
+    if (ring_instances == 0) {
+        return event_loop_wait(loop, ready_tags, max_tags, -1); // the deadline timer bounds the wait
+    }
+    if (pipe_players || ring_instances > 1) {
+        // Doorbells of different instances cannot be waited on together
+        return event_loop_wait(loop, ready_tags, max_tags, RING_PIPE_POLL_MS);
+    }
+    move_rings_wait(rings, seen, (deadline_in_ms >= 0 && deadline_in_ms < RING_IDLE_POLL_MS) ? deadline_in_ms : RING_IDLE_POLL_MS);
+    return event_loop_wait(loop, ready_tags, max_tags, 0);
+}
 
-        for (int j = 0; j < num_players; j++) {
-            int player_idx = (start_player + j) % num_players;
-            reader_lock(sync);
-            is_player_blocked = gs->players[player_idx].blocked;
-            reader_unlock(sync);
+static void check_think_deadlines(game_instance_t* inst, const args_t* args, int num_players, event_loop_t* loop, long long now_ms) {
+    bool overrun[MAX_PLAYERS] = { false };
+    bool any_overrun = false;
+    long long now_us = (args->stats_path != NULL) ? monotonic_us() : 0;
 
-            if (!is_player_blocked && FD_ISSET(fds[player_idx][0], &read_fds)) {
-                handle_player_event(player_idx, gs, sync, fds[player_idx][0], &last_successful_move_time);
+    for (int i = 0; i < num_players; i++) {
+        player_channel_t* channel = &inst->channels[i];
+        // The clock runs while the master has nothing of this player to commit
+        bool awaiting = !inst->gs->finished && !channel->blocked && !channel->eof && channel->pending_count == 0;
+        if (channel->awaiting && channel->arrived) {
+            // The move it owed came in, usually committed in this very round: its clock restarts
+            if (args->stats_path != NULL) {
+                stats_add_rtt(&inst->stats, now_us - channel->awaiting_since_us);
             }
+            channel->awaiting = false;
         }
+        if (!awaiting) {
+            channel->awaiting = false;
+        } else if (!channel->awaiting) {
+            channel->awaiting = true;
+            channel->think_since_ms = now_ms;
+            channel->awaiting_since_us = now_us;
+        } else if (args->think_ms > 0 && now_ms - channel->think_since_ms >= args->think_ms) {
+            overrun[i] = true;
+            any_overrun = true;
+            inst->stats.overruns++;
+            channel->think_since_ms = now_ms; // charged again if the next period also runs out
+        }
+    }
+    if (!any_overrun) {
+        return;
+    }
 
-        check_timeout_and_finish(gs, sync, args, last_successful_move_time);
-        check_all_blocked_and_finish(gs, sync);
-        update_view(gs, sync, args);
+    writer_lock(inst->sync);
+    for (int i = 0; i < num_players; i++) {
+        if (!overrun[i]) {
+            continue;
+        }
+        if (args->overrun_blocks) {
+            inst->channels[i].blocked = true;
+            inst->channels[i].awaiting = false;
+            inst->gs->players[i].blocked = true;
+            append_penalty(inst->journal, inst->gs, i, JOURNAL_BLOCK);
+        } else {
+            inst->gs->players[i].invalids++;
+            append_penalty(inst->journal, inst->gs, i, JOURNAL_OVERRUN);
+        }
+    }
+    writer_unlock(inst->sync);
 
-        start_player = (start_player + 1) % num_players;
-    } while (!gs->finished);
+    for (int i = 0; i < num_players && args->overrun_blocks; i++) {
+        if (overrun[i]) {
+            unwatch_channel(&inst->channels[i], loop);
+        }
+    }
+    check_all_blocked_and_finish(inst->gs, inst->sync, inst->channels, num_players);
+}
+
+static long long next_deadline_ms(const game_instance_t instances[], int num_instances, int num_players, const args_t* args) {
+    long long next = LLONG_MAX;
+    for (int k = 0; k < num_instances; k++) {
+        const game_instance_t* inst = &instances[k];
+        if (inst->done) {
+            continue;
+        }
+        if (inst->teardown.active) {
+            long long teardown = teardown_deadline_ms(inst, num_players);
+            if (teardown < next) {
+                next = teardown;
+            }
+            continue;
+        }
+        long long inactivity = inst->last_successful_move_ms + (long long)args->timeout * 1000;
+        if (inactivity < next) {
+            next = inactivity;
+        }
+        for (int i = 0; i < num_players && args->think_ms > 0; i++) {
+            const player_channel_t* channel = &inst->channels[i];
+            if (channel->awaiting && channel->think_since_ms + args->think_ms < next) {
+                next = channel->think_since_ms + args->think_ms;
+            }
+        }
+    }
+    return next;
+}
+
+static int deadline_timer_fd = -1;
+
+static int arm_deadline_timer(long long at_ms) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (at_ms != LLONG_MAX) {
+        if (at_ms <= 0) {
+            at_ms = 1; // it_value == 0 would disarm the timer
+        }
+        spec.it_value.tv_sec = (time_t)(at_ms / 1000);
+        spec.it_value.tv_nsec = (long)(at_ms % 1000) * 1000000L;
+    }
+    return timerfd_settime(deadline_timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static int start_deadline_timer(event_loop_t* loop) {
+    deadline_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (deadline_timer_fd == -1) {
+        perror("timerfd_create");
+        return -1;
+    }
+    if (event_loop_add(loop, deadline_timer_fd, TIMER_TAG) == -1) {
+        perror("event_loop_add");
+        return -1;
+    }
+    return 0;
+}
+
+static void stop_deadline_timer(event_loop_t* loop) {
+    if (deadline_timer_fd != -1) {
+        event_loop_remove(loop, deadline_timer_fd);
+        close(deadline_timer_fd);
+        deadline_timer_fd = -1;
+    }
+}
+
+static void play_round(game_instance_t* inst, const args_t* args, int num_players, event_loop_t* loop) {
+    player_channel_t* channels = inst->channels;
+
+    for (int i = 0; i < num_players && inst->rings != NULL; i++) {
+        drain_player_ring(&channels[i], loop);
+    }
+    for (int i = 0; i < num_players; i++) {
+        channels[i].arrived = channels[i].pending_count > 0;
+    }
+
+    if (commit_round(inst->gs, inst->sync, inst->journal, inst->mobility, channels, num_players, inst->start_player) > 0) {
+        inst->last_successful_move_ms = monotonic_ms();
+    }
+    inst->pending = false;
+    for (int i = 0; i < num_players; i++) {
+        if (channels[i].blocked) {
+            unwatch_channel(&channels[i], loop);
+        } else if (channels[i].pending_count > 0 || channels[i].eof) {
+            inst->pending = true;
+        }
+    }
+
+    // Penalties first: a -B block can end the game, and the view must get that frame
+    check_think_deadlines(inst, args, num_players, loop, monotonic_ms());
+    check_timeout_and_finish(inst->gs, inst->sync, args, inst->last_successful_move_ms, monotonic_ms());
+    check_move_limit_and_finish(inst->gs, inst->sync, args, num_players);
+    check_all_blocked_and_finish(inst->gs, inst->sync, channels, num_players);
+    if (inst->recorder != NULL) {
+        record_moves(inst->recorder, inst->gs, inst->journal); // moves and the penalties just charged
+    }
+    update_view(inst->gs, inst->sync, args);
+
+    inst->start_player = (inst->start_player + 1) % num_players;
+}
+
+static void collect_inproc_moves(game_instance_t instances[], int num_instances, int num_players) {
+    uint64_t completions;
+    while (read(strategy_notify_fd, &completions, sizeof(completions)) == -1 && errno == EINTR) {
+    }
+    for (int k = 0; k < num_instances; k++) {
+        for (int i = 0; i < num_players && !instances[k].teardown.active; i++) {
+            player_channel_t* channel = &instances[k].channels[i];
+            int move;
+            if (channel->inproc == NULL || !inproc_collect(channel->inproc, strategy_pool, &move)) {
+                continue;
+            }
+            if (move < 0) {
+                channel->eof = true; // same as a player closing its pipe
+            } else if (channel->pending_count < PENDING_MOVES) {
+                int tail = (channel->pending_head + channel->pending_count) % PENDING_MOVES;
+                channel->pending[tail] = (unsigned char)move;
+                channel->pending_count++;
+            }
+        }
+    }
+}
+
+static int start_strategy_pool(const args_t* args, int num_players, event_loop_t* loop) {
+    int inproc_players = 0;
+    for (int i = 0; i < num_players; i++) {
+        if (is_inproc_spec(args->player_paths[i])) {
+            inproc_players++;
+        }
+    }
+    if (inproc_players == 0) {
+        return 0;
+    }
+
+    strategy_notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (strategy_notify_fd == -1) {
+        perror("eventfd");
+        return -1;
+    }
+    // At most one request in flight per in-process player
+    strategy_pool = pool_create(0, inproc_players * (int)args->instances);
+    if (strategy_pool == NULL) {
+        return -1;
+    }
+    if (event_loop_add(loop, strategy_notify_fd, INPROC_TAG) == -1) {
+        perror("event_loop_add");
+        return -1;
+    }
+    return 0;
+}
+
+static void stop_strategy_pool(event_loop_t* loop) {
+    if (strategy_pool == NULL) {
+        return;
+    }
+    event_loop_remove(loop, strategy_notify_fd);
+    pool_destroy(strategy_pool);
+    close(strategy_notify_fd);
+    strategy_pool = NULL;
+    strategy_notify_fd = -1;
+}
+
+void play(game_instance_t instances[], int num_instances, const args_t* args, int num_players,
+          event_loop_t* loop, const char* width_s, const char* height_s, standing_t standings[]) {
+    static int ready_tags[EVENT_TAGS];
+    int active = num_instances;
+
+    for (int k = 0; k < num_instances; k++) {
+        begin_game(&instances[k], args, num_instances, num_players, loop, width_s, height_s);
+    }
+
+    while (active > 0) {
+        // One timer for every instance: the earliest inactivity or think deadline
+        long long deadline = next_deadline_ms(instances, num_instances, num_players, args);
+        if (arm_deadline_timer(deadline) == -1) {
+            perror("timerfd_settime");
+        }
+        int deadline_in = -1;
+        if (deadline != LLONG_MAX) {
+            long long left = deadline - monotonic_ms();
+            deadline_in = (left < 0) ? 0 : (left > INT_MAX) ? INT_MAX : (int)left;
+        }
+        int ready = wait_for_moves(loop, instances, num_instances, num_players, ready_tags,
+                                   EVENT_TAGS, deadline_in);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("event_loop_wait");
+            break;
+        }
+
+        bool timer_fired = false;
+        bool inproc_done = false;
+        for (int r = 0; r < ready; r++) {
+            if (ready_tags[r] == TIMER_TAG) {
+                uint64_t expirations;
+                while (read(deadline_timer_fd, &expirations, sizeof(expirations)) == -1 && errno == EINTR) {
+                }
+                timer_fired = true;
+                continue;
+            }
+            if (ready_tags[r] == INPROC_TAG) {
+                collect_inproc_moves(instances, num_instances, num_players);
+                inproc_done = true;
+                continue;
+            }
+            if (ready_tags[r] >= EXIT_TAG) {
+                instances[(ready_tags[r] - EXIT_TAG) / EXIT_SLOTS].teardown.poked = true;
+                continue;
+            }
+            game_instance_t* inst = &instances[ready_tags[r] / MAX_PLAYERS];
+            player_channel_t* channel = &inst->channels[ready_tags[r] % MAX_PLAYERS];
+            if (inst->teardown.active) {
+                discard_pipe(channel); // -r: late moves of the finished game
+                if (channel->eof) {
+                    unwatch_channel(channel, loop);
+                }
+            } else {
+                drain_player_channel(channel, loop);
+            }
+        }
+
+        for (int k = 0; k < num_instances; k++) {
+            game_instance_t* inst = &instances[k];
+            if (inst->done) {
+                continue;
+            }
+            if (!inst->teardown.active) {
+                play_round(inst, args, num_players, loop);
+                if (!inst->gs->finished) {
+                    continue;
+                }
+                begin_teardown(inst, args, num_players, loop);
+            } else if (!inst->teardown.poked && !timer_fired && !inproc_done) {
+                continue;
+            }
+            if (!advance_teardown(inst, num_players, loop)) {
+                continue;
+            }
+            finish_game(inst, args, num_players, standings);
+            if (inst->done) {
+                active--;
+            } else {
+                begin_game(inst, args, num_instances, num_players, loop, width_s, height_s);
+            }
+        }
+    }
 }
 
 int main(int argc, char *argv[]) {
@@ -479,55 +1563,50 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    game_state_t* gs = allocate_game_state_shm(args.width, args.height);
-    if (gs == NULL) {
-        fprintf(stderr, "Failed to allocate game state shared memory\n");
-        exit(1);
-    }
-    init_game_state(gs, &args, num_players);
-
-    sync_t* sync = allocate_sync_shm();
-    if (sync == NULL) {
-        fprintf(stderr, "Failed to allocate sync shared memory\n");
-        exit(1);
+    static game_instance_t instances[MAX_INSTANCES];
+    int num_instances = (int)args.instances;
+    install_teardown(instances, num_instances);
+    for (int k = 0; k < num_instances; k++) {
+        if (setup_instance(&instances[k], k, num_instances, &args) == -1) {
+            exit(1);
+        }
     }
-    init_sync(sync);
 
     char width_s[MAX_INT_SIZE];
     char height_s[MAX_INT_SIZE];
     snprintf(width_s, sizeof(width_s), "%d", args.width);
     snprintf(height_s, sizeof(height_s), "%d", args.height);
 
-    pid_t pid_v = -1;
-    if (args.view_path != NULL) {
-        pid_v = create_view_process(args.view_path, width_s, height_s);
+    event_loop_t* loop = event_loop_create(args.backend);
+    if (loop == NULL) {
+        fprintf(stderr, "Failed to create event loop\n");
+        exit(1);
     }
-
-    int fds[MAX_PLAYERS][2];
-    int max_fd = -1;
-    for (int i = 0; i < num_players; i++) {
-        if (pipe(fds[i]) == -1) {
-            perror("pipe");
-            exit(1);
-        }
-        pid_t pid_p = create_player_process(args.player_paths[i], width_s, height_s, fds[i]);
-        if (pid_p < 0) {
-            fprintf(stderr, "Failed to create player process %d\n", i);
-            exit(1);
-        }
-        gs->players[i].pid = pid_p;
-        if (fds[i][0] > max_fd) {
-            max_fd = fds[i][0];
-        }
+    if (start_deadline_timer(loop) == -1) {
+        fprintf(stderr, "Failed to create the deadline timer\n");
+        exit(1);
+    }
+    if (start_strategy_pool(&args, num_players, loop) == -1) {
+        fprintf(stderr, "Failed to start the in-process strategy pool\n");
+        exit(1);
     }
 
-    play(gs, sync, &args, fds, num_players, max_fd);
+    standing_t standings[MAX_PLAYERS];
+    memset(standings, 0, sizeof(standings));
 
-    wait_all(gs, pid_v);
-    print_winners(gs);
+    play(instances, num_instances, &args, num_players, loop, width_s, height_s, standings);
 
-    close_fds(fds, num_players);
-    destroy_sync(sync);
-    cleanup_shared_memory();
+    unsigned int total_games = args.games * args.instances;
+    if (total_games > 1) {
+        print_standings(instances[0].gs, standings, num_players, total_games);
+    }
+
+    stop_strategy_pool(loop);
+    stop_deadline_timer(loop);
+    event_loop_destroy(loop);
+    teardown_count = 0;
+    for (int k = 0; k < num_instances; k++) {
+        cleanup_instance(&instances[k]);
+    }
     return 0;
 }
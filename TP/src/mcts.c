@@ -0,0 +1,402 @@
+#define _GNU_SOURCE
+#include "mcts.h"
+#include "ai.h"
+#include "pool.h"
+#include "util.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct mcts_node {
+    struct mcts_node *parent;
+    struct mcts_node *child;    // first child
+    struct mcts_node *sibling;  // next child of the same parent
+    unsigned int visits;
+    float wins;                 // rollouts won by the side that played dir
+    signed char dir;            // move leading here, -1 for a pass
+    unsigned char side;         // side that played dir
+    unsigned char untried;      // bitmask of directions of the side to move not expanded yet
+    bool terminal;              // neither side can move
+} mcts_node_t;
+
+typedef struct {
+    unsigned short x, y;
+    int value;
+    unsigned char side;
+} mcts_undo_t;
+
+// One tree: private board, undo stack, node arena and RNG. Slots are owned by
+// the calling thread and lent to pool workers for the duration of a move.
+typedef struct {
+    game_state_t *board;
+    size_t board_size;
+    mcts_undo_t *undo;          // one entry per cell: every move consumes one
+    size_t undo_cap;
+    int undo_len;
+    mcts_node_t *arena;
+    int arena_used;
+    uint64_t rng;
+    int side[2];                // searching player, nearest opponent (-1: none)
+    unsigned int gain[2];       // points taken by each side since the root
+    long long deadline_ms;
+    unsigned int root_visits[8];
+} mcts_worker_t;
+
+typedef struct {
+    mcts_worker_t workers[MCTS_MAX_WORKERS];
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    int running;                // pool tasks of the current move still searching
+} mcts_context_t;
+
+static pthread_key_t context_key;
+static pthread_once_t context_once = PTHREAD_ONCE_INIT;
+static thread_pool_t *mcts_pool;
+static int mcts_workers = 1;
+
+static void context_free(void *arg) {
+    mcts_context_t *ctx = arg;
+    for (int i = 0; i < MCTS_MAX_WORKERS; i++) {
+        free(ctx->workers[i].board);
+        free(ctx->workers[i].undo);
+        free(ctx->workers[i].arena);
+    }
+    pthread_cond_destroy(&ctx->finished);
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
+}
+
+// One tree per online CPU: the calling thread plus cpus - 1 pool workers, shared by
+// every thread of the process (a move only borrows the idle ones)
+static void context_key_init(void) {
+    if (pthread_key_create(&context_key, context_free) != 0) {
+        perror("pthread_key_create");
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = (cpus > 1) ? (int)cpus - 1 : 0;
+    if (threads > MCTS_MAX_WORKERS - 1) threads = MCTS_MAX_WORKERS - 1;
+    if (threads > 0) {
+        mcts_pool = pool_create(threads, MCTS_MAX_WORKERS * 4);
+    }
+    mcts_workers = (mcts_pool != NULL) ? pool_threads(mcts_pool) + 1 : 1;
+}
+
+// Runs at exit and when libai.so is unloaded, so no worker outlives the code
+__attribute__((destructor))
+static void mcts_pool_stop(void) {
+    pool_destroy(mcts_pool);
+    mcts_pool = NULL;
+}
+
+static mcts_context_t *context_get(void) {
+    pthread_once(&context_once, context_key_init);
+    mcts_context_t *ctx = pthread_getspecific(context_key);
+    if (ctx == NULL) {
+        ctx = calloc(1, sizeof(*ctx));
+        if (ctx == NULL) {
+            perror("calloc MCTS context");
+            return NULL;
+        }
+        pthread_mutex_init(&ctx->lock, NULL);
+        pthread_cond_init(&ctx->finished, NULL);
+        if (pthread_setspecific(context_key, ctx) != 0) {
+            context_free(ctx);
+            return NULL;
+        }
+    }
+    return ctx;
+}
+
+static bool worker_reserve(mcts_worker_t *w, size_t board_size, size_t cells) {
+    if (w->arena == NULL) {
+        w->arena = malloc(MCTS_ARENA_NODES * sizeof(mcts_node_t));
+        if (w->arena == NULL) {
+            perror("malloc MCTS arena");
+            return false;
+        }
+    }
+    if (w->board_size < board_size) {
+        game_state_t *board = realloc(w->board, board_size);
+        if (board == NULL) {
+            perror("realloc MCTS board");
+            return false;
+        }
+        w->board = board;
+        w->board_size = board_size;
+    }
+    if (w->undo_cap < cells) {
+        mcts_undo_t *undo = realloc(w->undo, cells * sizeof(mcts_undo_t));
+        if (undo == NULL) {
+            perror("realloc MCTS undo stack");
+            return false;
+        }
+        w->undo = undo;
+        w->undo_cap = cells;
+    }
+    return true;
+}
+
+// xorshift64*
+static uint64_t rng_next(mcts_worker_t *w) {
+    w->rng ^= w->rng >> 12;
+    w->rng ^= w->rng << 25;
+    w->rng ^= w->rng >> 27;
+    return w->rng * 0x2545f4914f6cdd1dull;
+}
+
+static unsigned char legal_moves(const mcts_worker_t *w, int side) {
+    const game_state_t *gs = w->board;
+    int p = w->side[side];
+    unsigned char mask = 0;
+    if (p < 0) {
+        return 0;
+    }
+    for (int k = 0; k < 8; k++) {
+        int nx = gs->players[p].x + DIRS[k][0];
+        int ny = gs->players[p].y + DIRS[k][1];
+        if (in_bounds(gs, nx, ny) && is_free_cell(get_cell(gs, nx, ny))) mask |= (unsigned char)(1u << k);
+    }
+    return mask;
+}
+
+static void play(mcts_worker_t *w, int side, int dir) {
+    game_state_t *gs = w->board;
+    player_t *pl = &gs->players[w->side[side]];
+    int nx = pl->x + DIRS[dir][0];
+    int ny = pl->y + DIRS[dir][1];
+    mcts_undo_t *u = &w->undo[w->undo_len++];
+    u->x = pl->x;
+    u->y = pl->y;
+    u->value = get_cell(gs, nx, ny);
+    u->side = (unsigned char)side;
+    set_cell(gs, nx, ny, -w->side[side]);
+    pl->x = (unsigned short)nx;
+    pl->y = (unsigned short)ny;
+    w->gain[side] += (unsigned int)u->value;
+}
+
+static void undo_all(mcts_worker_t *w) {
+    game_state_t *gs = w->board;
+    while (w->undo_len > 0) {
+        mcts_undo_t *u = &w->undo[--w->undo_len];
+        player_t *pl = &gs->players[w->side[u->side]];
+        set_cell(gs, pl->x, pl->y, u->value);
+        pl->x = u->x;
+        pl->y = u->y;
+    }
+    w->gain[0] = w->gain[1] = 0;
+}
+
+static mcts_node_t *new_node(mcts_worker_t *w, mcts_node_t *parent, int dir, int side) {
+    if (w->arena_used == MCTS_ARENA_NODES) {
+        return NULL;
+    }
+    mcts_node_t *n = &w->arena[w->arena_used++];
+    memset(n, 0, sizeof(*n));
+    n->parent = parent;
+    n->dir = (signed char)dir;
+    n->side = (unsigned char)side;
+    if (parent != NULL) {
+        n->sibling = parent->child;
+        parent->child = n;
+    }
+    return n;
+}
+
+// Moves of the side to move once the board is at node n (side 1 - n->side),
+// or a single pass when only the other side can move
+static void init_untried(mcts_worker_t *w, mcts_node_t *n) {
+    int to_move = 1 - n->side;
+    n->untried = legal_moves(w, to_move);
+    n->terminal = n->untried == 0 && legal_moves(w, n->side) == 0;
+}
+
+static void step(mcts_worker_t *w, int side, int dir) {
+    if (dir >= 0) play(w, side, dir);
+}
+
+// Light rollout: each side plays a random legal move (random start, first free
+// direction clockwise), passing when stuck
+static int rollout(mcts_worker_t *w, int to_move) {
+    int stuck = 0;
+    for (int ply = 0; ply < MCTS_ROLLOUT_PLIES && stuck < 2; ply++) {
+        unsigned char mask = legal_moves(w, to_move);
+        if (mask == 0) {
+            stuck++;
+        } else {
+            stuck = 0;
+            int k = (int)(rng_next(w) & 7);
+            while (!(mask & (1u << k))) k = (k + 1) & 7;
+            play(w, to_move, k);
+        }
+        to_move = 1 - to_move;
+    }
+    return to_move;
+}
+
+static mcts_node_t *select_child(mcts_node_t *n) {
+    mcts_node_t *best = NULL;
+    float best_uct = -1.0f;
+    float log_visits = logf((float)n->visits + 1.0f);
+    for (mcts_node_t *c = n->child; c != NULL; c = c->sibling) {
+        float uct = c->wins / (float)c->visits + MCTS_EXPLORATION * sqrtf(log_visits / (float)c->visits);
+        if (uct > best_uct) {
+            best_uct = uct;
+            best = c;
+        }
+    }
+    return best;
+}
+
+static void search_tree(mcts_worker_t *w) {
+    w->arena_used = 0;
+    w->undo_len = 0;
+    w->gain[0] = w->gain[1] = 0;
+    mcts_node_t *root = new_node(w, NULL, -1, 1);   // side 1 "played" last: side 0 to move
+    init_untried(w, root);
+
+    do {
+        for (int i = 0; i < 16; i++) {
+            // Selection: descend while every move of the node has a child
+            mcts_node_t *n = root;
+            while (!n->terminal && n->untried == 0 && n->child != NULL) {
+                n = select_child(n);
+                step(w, n->side, n->dir);
+            }
+
+            // Expansion: one untried move (or the pass of a stuck side)
+            if (!n->terminal) {
+                int to_move = 1 - n->side;
+                int dir = -1;
+                if (n->untried != 0) {
+                    int k = (int)(rng_next(w) & 7);
+                    while (!(n->untried & (1u << k))) k = (k + 1) & 7;
+                    dir = k;
+                }
+                if (n->untried != 0 || n->child == NULL) {
+                    mcts_node_t *c = new_node(w, n, dir, to_move);
+                    if (c != NULL) {
+                        if (dir >= 0) n->untried &= (unsigned char)~(1u << dir);
+                        step(w, to_move, dir);
+                        init_untried(w, c);
+                        n = c;
+                    }
+                }
+            }
+
+            // Simulation, scored on points taken since the root
+            rollout(w, 1 - n->side);
+            float result = (w->gain[0] > w->gain[1]) ? 1.0f : (w->gain[0] == w->gain[1]) ? 0.5f : 0.0f;
+            undo_all(w);
+
+            // Backpropagation
+            for (; n != NULL; n = n->parent) {
+                n->visits++;
+                n->wins += (n->side == 0) ? result : 1.0f - result;
+            }
+        }
+    } while (monotonic_ms() < w->deadline_ms);
+
+    memset(w->root_visits, 0, sizeof(w->root_visits));
+    for (mcts_node_t *c = root->child; c != NULL; c = c->sibling) {
+        if (c->dir >= 0) w->root_visits[c->dir] = c->visits;
+    }
+}
+
+typedef struct {
+    mcts_context_t *ctx;
+    int worker;
+} mcts_task_t;
+
+static void search_task(void *arg) {
+    mcts_task_t *task = arg;
+    mcts_context_t *ctx = task->ctx;
+    search_tree(&ctx->workers[task->worker]);
+    pthread_mutex_lock(&ctx->lock);
+    if (--ctx->running == 0) {
+        pthread_cond_signal(&ctx->finished);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+int choose_best_move_mcts(int *move, const game_state_t *gs, sync_t *sync, int id) {
+    long long deadline_ms = monotonic_ms() + ai_time_budget_ms();
+    mcts_context_t *ctx = context_get();
+    size_t size = game_state_size(gs->width, gs->height, board_layout(gs));
+    size_t cells = (size_t)gs->width * gs->height;
+    if (ctx == NULL || !worker_reserve(&ctx->workers[0], size, cells)) {
+        return choose_best_move(move, gs, sync, id);
+    }
+
+    mcts_worker_t *root = &ctx->workers[0];
+    if (sync != NULL) {
+        snapshot_game_state(root->board, gs, sync);
+    } else {
+        memcpy(root->board, gs, size);
+    }
+    root->side[0] = id;
+    root->side[1] = ai_nearest_opponent(root->board, id);
+    unsigned char moves = legal_moves(root, 0);
+    if (moves == 0) {
+        return -1;
+    }
+
+    int best_dir = -1;
+    if ((moves & (moves - 1)) == 0) {
+        best_dir = __builtin_ctz(moves);    // forced move
+    } else {
+        mcts_task_t tasks[MCTS_MAX_WORKERS];
+        int workers = 1;
+        ctx->running = 0;
+        for (int i = 1; i < mcts_workers; i++) {
+            mcts_worker_t *w = &ctx->workers[i];
+            if (!worker_reserve(w, size, cells)) break;
+            memcpy(w->board, root->board, size);
+            w->side[0] = root->side[0];
+            w->side[1] = root->side[1];
+            w->deadline_ms = deadline_ms;
+            w->rng = ((uint64_t)deadline_ms << 8) ^ (0x9e3779b97f4a7c15ull * (uint64_t)(i + 1));
+            tasks[i].ctx = ctx;
+            tasks[i].worker = i;
+            pthread_mutex_lock(&ctx->lock);
+            ctx->running++;
+            pthread_mutex_unlock(&ctx->lock);
+            // Busy workers belong to another caller's move (in-process players share the
+            // pool): queueing behind them would run this move past its budget
+            if (pool_try_submit(mcts_pool, search_task, &tasks[i]) == -1) {
+                pthread_mutex_lock(&ctx->lock);
+                ctx->running--;
+                pthread_mutex_unlock(&ctx->lock);
+                break;
+            }
+            workers++;
+        }
+
+        root->deadline_ms = deadline_ms;
+        root->rng = ((uint64_t)deadline_ms << 8) ^ 0x9e3779b97f4a7c15ull;
+        search_tree(root);
+
+        pthread_mutex_lock(&ctx->lock);
+        while (ctx->running > 0) {
+            pthread_cond_wait(&ctx->finished, &ctx->lock);
+        }
+        pthread_mutex_unlock(&ctx->lock);
+
+        unsigned int best_visits = 0;
+        for (int k = 0; k < 8; k++) {
+            unsigned int visits = 0;
+            for (int i = 0; i < workers; i++) visits += ctx->workers[i].root_visits[k];
+            if ((moves & (1u << k)) && (best_dir < 0 || visits > best_visits)) {
+                best_visits = visits;
+                best_dir = k;
+            }
+        }
+    }
+
+    move[0] = DIRS[best_dir][0];
+    move[1] = DIRS[best_dir][1];
+    return 0;
+}
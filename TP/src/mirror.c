@@ -0,0 +1,155 @@
+#define _GNU_SOURCE
+#include "mirror.h"
+#include "util.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+board_mirror_t *mirror_create(const game_state_t *shared, const move_journal_t *journal) {
+    board_mirror_t *mirror = calloc(1, sizeof(*mirror));
+    if (mirror == NULL) {
+        perror("calloc board mirror");
+        return NULL;
+    }
+    mirror->size = game_state_size(shared->width, shared->height, board_layout(shared));
+    mirror->state = calloc(1, mirror->size);   // width 0: the first update is a full copy
+    if (mirror->state == NULL) {
+        perror("calloc board mirror state");
+        free(mirror);
+        return NULL;
+    }
+    mirror->journal = journal;
+    return mirror;
+}
+
+void mirror_destroy(board_mirror_t *mirror) {
+    if (mirror == NULL) {
+        return;
+    }
+    free(mirror->state);
+    free(mirror);
+}
+
+// Consistent copy of the first bytes of the shared state (the header, or all
+// of it) and of the journal position, seqlock-protected
+static void read_shared(const board_mirror_t *mirror, game_state_t *dst, size_t bytes, const game_state_t *shared,
+                        sync_t *sync, unsigned int *head, unsigned int *game) {
+    for (unsigned int attempt = 0; ; attempt++) {
+        unsigned int seq = __atomic_load_n(&sync->state_seq, __ATOMIC_ACQUIRE);
+        if ((seq & 1) == 0) {
+            memcpy(dst, shared, bytes);
+            if (mirror->journal != NULL) {
+                *head = journal_head(mirror->journal);
+                *game = __atomic_load_n(&mirror->journal->game, __ATOMIC_ACQUIRE);
+            }
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&sync->state_seq, __ATOMIC_RELAXED) == seq) {
+                return;
+            }
+        }
+        if (attempt >= SNAPSHOT_SPINS) {
+            sched_yield();
+        }
+    }
+}
+
+// Without a journal: at most one valid move per player, landing next to the old head
+static bool apply_heads(game_state_t *state, const game_state_t *header) {
+    for (unsigned int p = 0; p < header->num_players; p++) {
+        const player_t *now = &header->players[p];
+        const player_t *was = &state->players[p];
+        unsigned int moves = now->valids - was->valids;
+        bool ok;
+        if (moves == 0) {
+            ok = now->x == was->x && now->y == was->y;
+        } else {
+            ok = moves == 1 && abs(now->x - was->x) <= 1 && abs(now->y - was->y) <= 1;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+
+    // Every valid move claims the cell the head lands on: that is the whole board delta
+    for (unsigned int p = 0; p < header->num_players; p++) {
+        if (header->players[p].valids != state->players[p].valids) {
+            set_cell(state, header->players[p].x, header->players[p].y, -(int)p);
+        }
+    }
+    return true;
+}
+
+// With a journal: the valid entries up to head. A player that simulated moves
+// keeps them only if the master accepted exactly those cells and nothing else.
+static bool apply_journal(board_mirror_t *mirror, const game_state_t *header, unsigned int head) {
+    game_state_t *state = mirror->state;
+    unsigned int simulated = 0;
+    for (unsigned int p = 0; p < header->num_players; p++) {
+        if (state->players[p].valids != mirror->synced_valids[p]) {
+            if (header->players[p].valids != state->players[p].valids) {
+                return false;
+            }
+            simulated |= 1u << p;
+        }
+    }
+
+    journal_entry_t batch[MIRROR_JOURNAL_BATCH];
+    while (mirror->journal_seq != head) {
+        unsigned int left = head - mirror->journal_seq;
+        int n = journal_read(mirror->journal, mirror->journal_seq, batch,
+                             (left < MIRROR_JOURNAL_BATCH) ? (int)left : MIRROR_JOURNAL_BATCH);
+        if (n <= 0) {
+            return false;   // overrun: entries lost
+        }
+        for (int i = 0; i < n; i++) {
+            const journal_entry_t *e = &batch[i];
+            int p = e->player;
+            if (p >= (int)header->num_players) {
+                return false;
+            }
+            if (e->kind != JOURNAL_MOVE) {
+                continue;   // a penalty, not part of anyone's plan
+            }
+            if (simulated & (1u << p)) {
+                // Cells the player simulated are already -p; an accepted cell
+                // that is not, or a rejection, means its plan diverged
+                if (!e->valid || get_cell(state, e->to_x, e->to_y) != -p) {
+                    return false;
+                }
+            } else if (e->valid) {
+                set_cell(state, e->to_x, e->to_y, -p);
+            }
+        }
+        mirror->journal_seq += (unsigned int)n;
+    }
+    return true;
+}
+
+void mirror_update(board_mirror_t *mirror, const game_state_t *shared, sync_t *sync) {
+    game_state_t *state = mirror->state;
+    game_state_t header;
+    unsigned int head = 0, game = 0;
+    read_shared(mirror, &header, sizeof(header), shared, sync, &head, &game);
+
+    bool delta = header.width == state->width && header.height == state->height &&
+                 header.num_players == state->num_players;
+    if (delta && mirror->journal != NULL) {
+        delta = game == mirror->journal_game && apply_journal(mirror, &header, head);
+    } else if (delta) {
+        delta = apply_heads(state, &header);
+    }
+
+    if (delta) {
+        memcpy(state, &header, sizeof(game_state_t));
+        mirror->delta_syncs++;
+    } else {
+        read_shared(mirror, state, mirror->size, shared, sync, &head, &game);
+        mirror->journal_seq = head;
+        mirror->journal_game = game;
+        mirror->full_syncs++;
+    }
+    for (unsigned int p = 0; p < state->num_players; p++) {
+        mirror->synced_valids[p] = state->players[p].valids;
+    }
+}
@@ -1,13 +1,44 @@
+#define _GNU_SOURCE
 #include "common.h"
 #include "util.h"
 #include "ai.h"
 #include "player.h"
+#include "search.h"
+#include "mcts.h"
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "sync.h"
+#include "ring.h"
+#include "mirror.h"
+
+static const struct {
+    const char *name;
+    ai_strategy_t strategy;
+} STRATEGIES[] = {
+    { "voronoi", choose_best_move },
+    { "search",  choose_best_move_search },
+    { "mcts",    choose_best_move_mcts },
+    { "flood",   choose_best_move_flood },
+    { "naive",   choose_best_move_naive },
+};
+
+static ai_strategy_t select_strategy(void) {
+    const char *name = getenv(PLAYER_STRATEGY_ENV);
+    if (name == NULL || *name == '\0') {
+        return STRATEGIES[0].strategy;
+    }
+    for (size_t i = 0; i < sizeof(STRATEGIES) / sizeof(STRATEGIES[0]); i++) {
+        if (strcmp(name, STRATEGIES[i].name) == 0) {
+            return STRATEGIES[i].strategy;
+        }
+    }
+    fprintf(stderr, "Player: unknown %s '%s', using %s\n", PLAYER_STRATEGY_ENV, name, STRATEGIES[0].name);
+    return STRATEGIES[0].strategy;
+}
 
 int main(int argc, char *argv[]) {
     if(argc < 3){
@@ -44,31 +75,108 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    int move_dir[2] = {0, 0};
+    // Shared-memory move ring if the master offers one; otherwise the pipe protocol
+    move_rings_t *rings = attach_move_rings_shm();
+    if (rings != NULL) {
+        __atomic_store_n(&rings->rings[id].active, 1, __ATOMIC_RELEASE);
+    }
+
+    // Private mirror refreshed each turn from the deltas since the previous one,
+    // read from the master's move journal when it offers one
+    board_mirror_t *mirror = mirror_create(game_state, attach_journal_shm());
+    if (mirror == NULL) {
+        perror("Failed to allocate game state mirror");
+        exit(1);
+    }
+    if (ai_init(width, height) == -1) {
+        perror("Failed to allocate AI workspace");
+        exit(1);
+    }
+
+    // Credit window negotiated with the master: plan up to that many moves per
+    // round trip, and only once every move of the previous plan was processed.
+    int window = (int)sync->move_credits;
+    if (window < 1) {
+        window = 1;
+    } else if (window > MAX_MOVE_CREDITS) {
+        window = MAX_MOVE_CREDITS;
+    }
+
+    unsigned char plan[MAX_MOVE_CREDITS];
+    ai_strategy_t strategy = select_strategy();
+
+    // -r: the same process plays every game; between games it parks on game_generation
+    for (;;) {
+        unsigned int generation = __atomic_load_n(&sync->game_generation, __ATOMIC_ACQUIRE);
+        int held = 0;
+
+        for (;;) {
+            while (held < window) {
+                if (rings != NULL) {
+                    move_ring_take_credit(&rings->rings[id]);
+                } else if (sem_wait(&sync->move_signal[id]) != 0) {
+                    continue;
+                }
+                held++;
+            }
 
-    while(sem_wait(&sync->move_signal[id]) || choose_best_move(move_dir, game_state, sync, id) != -1){
-        unsigned char dir_to_send = direction_to_char(move_dir);
-        if(dir_to_send == 255) {
-            perror("Invalid move direction");
-            continue;
+            mirror_update(mirror, game_state, sync);
+            game_state_t *snapshot = mirror->state;
+            if (snapshot->finished) {
+                break;
+            }
+            int planned = plan_moves(plan, held, snapshot, id, strategy);
+            if (planned == 0) {
+                break;
+            }
+            for (int i = 0; i < planned; i++) {
+                unsigned char byte = (i == 0) ? plan[i] : (unsigned char)(plan[i] | MOVE_PLAN_CONT);
+                if (rings != NULL) {
+                    move_ring_push(rings, id, byte);
+                } else {
+                    putchar(byte);
+                }
+            }
+            if (rings == NULL) {
+                fflush(stdout);
+            }
+            held -= planned;
         }
-        printf("%c", dir_to_send);
-        fflush(stdout);
+
+        if (!sync->players_reused) {
+            break;
+        }
+        __atomic_store_n(&sync->player_game_ack[id], generation + 1, __ATOMIC_RELEASE);
+        futex_wake(&sync->player_game_ack[id], 1);
+        while (__atomic_load_n(&sync->game_generation, __ATOMIC_ACQUIRE) == generation) {
+            futex_wait(&sync->game_generation, generation, -1);
+        }
+        if (__atomic_load_n(&sync->players_shutdown, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+    if (rings != NULL) {
+        move_ring_close(rings, id);
     }
     fclose(stdout);
+    mirror_destroy(mirror);
 
     return 0;
 }
 
 int find_player_id(const game_state_t *gs, pid_t pid, sync_t * sync) {
     pid_t player_pid;
-    for (unsigned int i = 0; i < MAX_PLAYERS; i++) {
-        reader_lock(sync);
-        player_pid = gs->players[i].pid;
-        reader_unlock(sync);
-        if (player_pid == pid) {
-            return i;
+    // The master stores our pid right after fork(); we may get here first
+    for (int attempt = 0; attempt < PLAYER_ID_RETRIES; attempt++) {
+        for (unsigned int i = 0; i < MAX_PLAYERS; i++) {
+            reader_lock(sync);
+            player_pid = gs->players[i].pid;
+            reader_unlock(sync);
+            if (player_pid == pid) {
+                return i;
+            }
         }
+        usleep(PLAYER_ID_RETRY_US);
     }
     return -1;
 }
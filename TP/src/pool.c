@@ -0,0 +1,142 @@
+#define _GNU_SOURCE
+#include "pool.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    pool_task_fn fn;
+    void *arg;
+} pool_task_t;
+
+struct thread_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t has_tasks;
+    pool_task_t *tasks;       // circular FIFO of capacity entries
+    int capacity;
+    int head, count;
+    int idle;                 // workers waiting for a task
+    bool stopping;
+    int threads;
+    pthread_t *workers;
+};
+
+static void *pool_worker(void *arg) {
+    thread_pool_t *pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->count == 0 && !pool->stopping) {
+            pool->idle++;
+            pthread_cond_wait(&pool->has_tasks, &pool->lock);
+            pool->idle--;
+        }
+        if (pool->count == 0) {
+            break; // stopping and drained
+        }
+        pool_task_t task = pool->tasks[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+
+        pthread_mutex_unlock(&pool->lock);
+        task.fn(task.arg);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+thread_pool_t *pool_create(int threads, int capacity) {
+    if (threads < 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int)cpus : 1;
+    }
+    if (capacity < 1) {
+        capacity = 1;
+    }
+
+    thread_pool_t *pool = calloc(1, sizeof(*pool));
+    if (pool == NULL) {
+        perror("calloc thread pool");
+        return NULL;
+    }
+    pool->tasks = calloc((size_t)capacity, sizeof(pool_task_t));
+    pool->workers = calloc((size_t)threads, sizeof(pthread_t));
+    if (pool->tasks == NULL || pool->workers == NULL) {
+        perror("calloc thread pool");
+        free(pool->tasks);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+    pool->capacity = capacity;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->has_tasks, NULL);
+
+    for (int i = 0; i < threads; i++) {
+        int err = pthread_create(&pool->workers[i], NULL, pool_worker, pool);
+        if (err != 0) {
+            fprintf(stderr, "pthread_create: error %d\n", err);
+            pool_destroy(pool);
+            return NULL;
+        }
+        pool->threads++;
+    }
+
+    return pool;
+}
+
+// Caller holds pool->lock
+static int enqueue(thread_pool_t *pool, pool_task_fn fn, void *arg) {
+    if (pool->count == pool->capacity) {
+        return -1;
+    }
+    int tail = (pool->head + pool->count) % pool->capacity;
+    pool->tasks[tail].fn = fn;
+    pool->tasks[tail].arg = arg;
+    pool->count++;
+    pthread_cond_signal(&pool->has_tasks);
+    return 0;
+}
+
+int pool_submit(thread_pool_t *pool, pool_task_fn fn, void *arg) {
+    pthread_mutex_lock(&pool->lock);
+    int result = enqueue(pool, fn, arg);
+    pthread_mutex_unlock(&pool->lock);
+    return result;
+}
+
+int pool_try_submit(thread_pool_t *pool, pool_task_fn fn, void *arg) {
+    pthread_mutex_lock(&pool->lock);
+    // A woken worker still counts as idle until it takes its task: one task per idle worker
+    int result = (pool->count < pool->idle) ? enqueue(pool, fn, arg) : -1;
+    pthread_mutex_unlock(&pool->lock);
+    return result;
+}
+
+int pool_threads(const thread_pool_t *pool) {
+    return pool->threads;
+}
+
+void pool_destroy(thread_pool_t *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->has_tasks);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->has_tasks);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->tasks);
+    free(pool->workers);
+    free(pool);
+}
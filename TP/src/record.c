@@ -0,0 +1,288 @@
+#include "record.h"
+#include "util.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define VARINT_MAX_BYTES 10
+
+static void put_varint(FILE *file, uint64_t value) {
+    while (value >= 0x80) {
+        fputc((int)(value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static void put_keyframe(recorder_t *rec, const game_state_t *gs) {
+    put_varint(rec->file, rec->moves);
+    fwrite(gs->players, sizeof(player_t), gs->num_players, rec->file);
+    if (board_layout(gs) == BOARD_LAYOUT_V2) {
+        fwrite(board_cells_v2(gs), sizeof(int8_t), (size_t)gs->width * gs->height, rec->file);
+    } else {
+        for (int y = 0; y < gs->height; y++) {
+            for (int x = 0; x < gs->width; x++) {
+                fputc((int)(uint8_t)(int8_t)get_cell(gs, x, y), rec->file);
+            }
+        }
+    }
+    rec->since_keyframe = 0;
+}
+
+static int entry_dir(const journal_entry_t *e) {
+    for (int k = 0; k < 8; k++) {
+        if (e->from_x + DIRS[k][0] == e->to_x && e->from_y + DIRS[k][1] == e->to_y) {
+            return k;
+        }
+    }
+    return RECORD_NO_DIR;
+}
+
+recorder_t *recorder_open(const char *path) {
+    recorder_t *rec = calloc(1, sizeof(*rec));
+    if (rec == NULL) {
+        perror("calloc recorder");
+        return NULL;
+    }
+    rec->file = fopen(path, "wb");
+    if (rec->file == NULL) {
+        perror("fopen recording");
+        free(rec);
+        return NULL;
+    }
+    return rec;
+}
+
+int recorder_close(recorder_t *rec) {
+    if (rec == NULL) {
+        return 0;
+    }
+    int result = ferror(rec->file) ? -1 : 0;
+    if (fclose(rec->file) != 0) {
+        result = -1;
+    }
+    free(rec);
+    return result;
+}
+
+void record_game(recorder_t *rec, const game_state_t *gs, const move_journal_t *journal, unsigned int seed) {
+    if (!rec->header_written) {
+        record_header_t header;
+        memset(&header, 0, sizeof(header));
+        header.magic = RECORD_MAGIC;
+        header.version = RECORD_VERSION;
+        header.player_size = sizeof(player_t);
+        header.width = gs->width;
+        header.height = gs->height;
+        header.num_players = (uint8_t)gs->num_players;
+        header.layout = (uint8_t)board_layout(gs);
+        header.seed = seed;
+        header.keyframe_moves = RECORD_KEYFRAME_MOVES;
+        for (unsigned int i = 0; i < gs->num_players; i++) {
+            memcpy(header.names[i], gs->players[i].name, sizeof(header.names[i]));
+        }
+        fwrite(&header, sizeof(header), 1, rec->file);
+        rec->header_written = true;
+    }
+    rec->seq = journal_head(journal);
+    rec->moves = 0;
+    rec->last_move_ms = monotonic_ms();
+    put_varint(rec->file, REC_GAME);
+    put_varint(rec->file, seed);
+    put_keyframe(rec, gs);
+}
+
+void record_moves(recorder_t *rec, const game_state_t *gs, const move_journal_t *journal) {
+    journal_entry_t batch[64];
+    int n;
+    bool any = false;
+    // Only the master appends, and it is the caller: entries cannot be overrun here
+    while ((n = journal_read(journal, rec->seq, batch, 64)) > 0) {
+        for (int i = 0; i < n; i++) {
+            const journal_entry_t *e = &batch[i];
+            int dir = (e->kind == JOURNAL_BLOCK) ? RECORD_BLOCK : entry_dir(e);
+            put_varint(rec->file, REC_MOVE + e->player + MAX_PLAYERS * ((e->valid ? 1u : 0u) + 2u * (unsigned int)dir));
+            long long now = monotonic_ms();
+            put_varint(rec->file, (!any && now > rec->last_move_ms) ? (uint64_t)(now - rec->last_move_ms) : 0);
+            any = true;
+            rec->moves++;
+            rec->since_keyframe++;
+        }
+        rec->seq += (unsigned int)n;
+    }
+    if (any) {
+        rec->last_move_ms = monotonic_ms();
+    }
+    if (rec->since_keyframe >= RECORD_KEYFRAME_MOVES) {
+        put_varint(rec->file, REC_KEYFRAME);
+        put_keyframe(rec, gs);
+    }
+}
+
+void record_end(recorder_t *rec, const game_state_t *gs) {
+    put_varint(rec->file, REC_END);
+    put_keyframe(rec, gs);
+    fflush(rec->file);
+}
+
+int record_reader_open(record_reader_t *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("open recording");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat recording");
+        close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(record_header_t)) {
+        fprintf(stderr, "%s: not a recording\n", path);
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap recording");
+        return -1;
+    }
+    reader->data = data;
+    reader->size = (size_t)st.st_size;
+    reader->header = data;
+    reader->pos = sizeof(record_header_t);
+
+    const record_header_t *h = reader->header;
+    if (h->magic != RECORD_MAGIC || h->version < 1 || h->version > RECORD_VERSION || h->player_size != sizeof(player_t) ||
+        h->num_players < 1 || h->num_players > MAX_PLAYERS || h->width == 0 || h->height == 0) {
+        fprintf(stderr, "%s: unsupported recording\n", path);
+        record_reader_close(reader);
+        return -1;
+    }
+    return 0;
+}
+
+void record_reader_close(record_reader_t *reader) {
+    if (reader->data != NULL) {
+        munmap((void *)reader->data, reader->size);
+    }
+    memset(reader, 0, sizeof(*reader));
+}
+
+static bool get_varint(record_reader_t *reader, uint64_t *value) {
+    uint64_t v = 0;
+    for (int i = 0; i < VARINT_MAX_BYTES && reader->pos < reader->size; i++) {
+        uint8_t byte = reader->data[reader->pos++];
+        v |= (uint64_t)(byte & 0x7f) << (7 * i);
+        if ((byte & 0x80) == 0) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool get_keyframe(record_reader_t *reader, record_event_t *ev) {
+    const record_header_t *h = reader->header;
+    uint64_t move;
+    if (!get_varint(reader, &move)) {
+        return false;
+    }
+    size_t players = (size_t)h->num_players * sizeof(player_t);
+    size_t cells = (size_t)h->width * h->height;
+    if (reader->size - reader->pos < players + cells) {
+        return false;
+    }
+    ev->move = (unsigned int)move;
+    ev->players = (const player_t *)(const void *)(reader->data + reader->pos);
+    ev->cells = (const int8_t *)(reader->data + reader->pos + players);
+    reader->pos += players + cells;
+    return true;
+}
+
+int record_next(record_reader_t *reader, record_event_t *ev) {
+    if (reader->pos >= reader->size) {
+        return 0;
+    }
+    uint64_t tag, value;
+    if (!get_varint(reader, &tag)) {
+        return -1;
+    }
+    memset(ev, 0, sizeof(*ev));
+    switch (tag) {
+    case REC_GAME:
+        if (!get_varint(reader, &value)) {
+            return -1;
+        }
+        ev->seed = (unsigned int)value;
+        /* fall through */
+    case REC_KEYFRAME:
+    case REC_END:
+        ev->type = (int)tag;
+        return get_keyframe(reader, ev) ? 1 : -1;
+    default:
+        tag -= REC_MOVE;
+        ev->type = REC_MOVE;
+        ev->player = (int)(tag % MAX_PLAYERS);
+        ev->valid = (tag / MAX_PLAYERS) % 2 == 1;
+        ev->dir = (int)(tag / MAX_PLAYERS / 2);
+        if (ev->player >= reader->header->num_players || ev->dir > RECORD_BLOCK ||
+            (ev->valid && ev->dir >= RECORD_NO_DIR) || !get_varint(reader, &value)) {
+            return -1;
+        }
+        ev->delay_ms = (unsigned int)value;
+        return 1;
+    }
+}
+
+void record_load_keyframe(const record_reader_t *reader, const record_event_t *ev, game_state_t *gs) {
+    const record_header_t *h = reader->header;
+    gs->width = h->width;
+    gs->height = h->height;
+    gs->num_players = h->num_players;
+    memcpy(gs->players, ev->players, (size_t)h->num_players * sizeof(player_t));
+    gs->finished = ev->type == REC_END;
+    if (board_layout(gs) == BOARD_LAYOUT_V2) {
+        memcpy(board_cells_v2(gs), ev->cells, (size_t)gs->width * gs->height);
+    } else {
+        for (int y = 0; y < gs->height; y++) {
+            for (int x = 0; x < gs->width; x++) {
+                set_cell(gs, x, y, ev->cells[(size_t)y * gs->width + (size_t)x]);
+            }
+        }
+    }
+}
+
+int record_apply_move(const record_event_t *ev, game_state_t *gs) {
+    player_t *p = &gs->players[ev->player];
+    if (ev->dir == RECORD_BLOCK) {
+        p->blocked = true;
+        return 0;
+    }
+    if (!ev->valid) {
+        p->invalids++;
+        return 0;
+    }
+    int x = p->x + DIRS[ev->dir][0];
+    int y = p->y + DIRS[ev->dir][1];
+    if (!in_bounds(gs, x, y) || !is_free_cell(get_cell(gs, x, y))) {
+        return -1;
+    }
+    p->x = (unsigned short)x;
+    p->y = (unsigned short)y;
+    p->score += (unsigned int)get_cell(gs, x, y);
+    p->valids++;
+    set_cell(gs, x, y, -ev->player);
+    // A head with no free neighbour can never move again (same rule as the master)
+    for (unsigned int i = 0; i < gs->num_players; i++) {
+        if (!gs->players[i].blocked && count_free_neighbors(gs, gs->players[i].x, gs->players[i].y) == 0) {
+            gs->players[i].blocked = true;
+        }
+    }
+    return 0;
+}
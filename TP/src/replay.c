@@ -0,0 +1,323 @@
+#define _GNU_SOURCE
+#include "replay.h"
+#include "sync.h"
+#include "util.h"
+
+#define MAX_INT_SIZE 12
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+// Segment names, precomputed so the signal handler only calls shm_unlink()
+static char shm_names[2][SHM_NAME_LEN];
+
+typedef struct {
+    game_state_t* gs;
+    sync_t* sync;
+    pid_t view;                 // -1 when headless
+    unsigned int moves;         // moves of the current game applied to gs
+    unsigned int mismatches;    // keyframes the replayed state disagreed with
+    double next_move_ms;        // CLOCK_MONOTONIC ms the next move is due (-x > 0)
+} replay_t;
+
+int parse_replay_args(int argc, char **argv, replay_args_t *args) {
+    memset(args, 0, sizeof(*args));
+    int opt;
+    while ((opt = getopt(argc, argv, "v:x:s:g:")) != -1) {
+        switch (opt) {
+        case 'v':
+            args->view_path = optarg;
+            break;
+        case 'x':
+            args->speed = atof(optarg);
+            if (args->speed < 0) {
+                fprintf(stderr, "Error: -x no puede ser negativo\n");
+                return -1;
+            }
+            break;
+        case 's':
+            args->seek = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'g':
+            if (atoi(optarg) < 1) {
+                fprintf(stderr, "Error: -g debe ser al menos 1\n");
+                return -1;
+            }
+            args->game = (unsigned int)atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Uso: %s [-v view] [-x speed] [-s move] [-g game] archivo.ccr\n", argv[0]);
+            return -1;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Error: debe especificar un archivo de grabación\n");
+        return -1;
+    }
+    args->path = argv[optind];
+    return 0;
+}
+
+int seek_keyframe(record_reader_t *reader, const record_event_t *start, unsigned int target, record_event_t *keyframe) {
+    record_reader_t scan = *reader;
+    size_t best_pos = reader->pos;
+    record_event_t ev;
+    int r;
+    *keyframe = *start;
+    while ((r = record_next(&scan, &ev)) == 1 && ev.type != REC_GAME && ev.type != REC_END) {
+        if (ev.type == REC_KEYFRAME) {
+            if (ev.move > target) {
+                break;
+            }
+            *keyframe = ev;
+            best_pos = scan.pos;
+        }
+    }
+    if (r == -1) {
+        return -1;
+    }
+    reader->pos = best_pos;
+    return 0;
+}
+
+static void unlink_segments(void) {
+    for (int s = 0; s < 2; s++) {
+        shm_unlink(shm_names[s]);
+    }
+}
+
+static void on_fatal_signal(int sig) {
+    unlink_segments();
+    raise(sig); // SA_RESETHAND: default action from here
+}
+
+static void install_teardown(void) {
+    static const int signals[] = { SIGINT, SIGTERM, SIGHUP, SIGQUIT };
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_fatal_signal;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        sigaction(signals[i], &sa, NULL);
+    }
+}
+
+static pid_t create_view_process(const char* view_path, const record_header_t* header) {
+    char width_s[MAX_INT_SIZE];
+    char height_s[MAX_INT_SIZE];
+    snprintf(width_s, sizeof(width_s), "%d", header->width);
+    snprintf(height_s, sizeof(height_s), "%d", header->height);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork v");
+        return -1;
+    }
+    if (pid == 0) {
+        char *argv[] = { (char*)view_path, width_s, height_s, NULL };
+        execve(view_path, argv, environ);
+        perror("exec view");
+        _exit(1);
+    }
+    return pid;
+}
+
+// One synchronous frame: the view draws the current state before we go on
+static void show_frame(replay_t* rp) {
+    if (rp->view != -1) {
+        sem_post(&rp->sync->drawing_signal);
+        sem_wait(&rp->sync->not_drawing_signal);
+    }
+}
+
+static void wait_view(replay_t* rp) {
+    if (rp->view == -1) {
+        return;
+    }
+    while (waitpid(rp->view, NULL, 0) == -1 && errno == EINTR) {
+    }
+    rp->view = -1;
+}
+
+// CLOCK_MONOTONIC in fractional ms: recorded delays are mostly 0 or 1 ms, and
+// whole milliseconds would round a sped-up replay (and its timing) to nothing
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static void sleep_until(double at_ms) {
+    double left = at_ms - now_ms();
+    if (left > 0) {
+        struct timespec ts = { .tv_sec = (time_t)(left / 1000), .tv_nsec = (long)(fmod(left, 1000.0) * 1e6) };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// The replayed state must match every keyframe the master wrote
+static bool matches_keyframe(const record_reader_t* reader, const record_event_t* ev, const game_state_t* gs) {
+    for (unsigned int i = 0; i < reader->header->num_players; i++) {
+        player_t p;
+        memcpy(&p, &ev->players[i], sizeof(p));
+        const player_t* q = &gs->players[i];
+        if (p.x != q->x || p.y != q->y || p.score != q->score || p.valids != q->valids || p.invalids != q->invalids ||
+            p.blocked != q->blocked) {
+            return false;
+        }
+    }
+    for (int y = 0; y < gs->height; y++) {
+        for (int x = 0; x < gs->width; x++) {
+            if (ev->cells[(size_t)y * gs->width + (size_t)x] != get_cell(gs, x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void load_keyframe(replay_t* rp, const record_reader_t* reader, const record_event_t* ev) {
+    writer_lock(rp->sync);
+    record_load_keyframe(reader, ev, rp->gs);
+    writer_unlock(rp->sync);
+    rp->moves = ev->move;
+}
+
+// Runs one game from its REC_GAME record; returns -1 on a corrupt recording
+static int replay_game(replay_t* rp, record_reader_t* reader, const record_event_t* start, const replay_args_t* args,
+                       unsigned int game_number) {
+    record_event_t ev = *start;
+    if (args->seek > 0 && seek_keyframe(reader, start, args->seek, &ev) == -1) {
+        return -1;
+    }
+    load_keyframe(rp, reader, &ev);
+
+    // Up to the seek target without frames or delays
+    size_t resume = reader->pos;
+    int r;
+    while (rp->moves < args->seek && (r = record_next(reader, &ev)) == 1 && ev.type == REC_MOVE) {
+        if (record_apply_move(&ev, rp->gs) == -1) {
+            return -1;
+        }
+        rp->moves++;
+        resume = reader->pos;
+    }
+    reader->pos = resume;
+
+    if (args->view_path != NULL) {
+        rp->view = create_view_process(args->view_path, reader->header);
+    }
+    show_frame(rp);
+
+    double start_ms = now_ms();
+    unsigned int first_move = rp->moves;
+    rp->next_move_ms = start_ms;
+    while ((r = record_next(reader, &ev)) == 1) {
+        if (ev.type == REC_MOVE) {
+            if (args->speed > 0) {
+                rp->next_move_ms += ev.delay_ms / args->speed;
+                sleep_until(rp->next_move_ms);
+            }
+            writer_lock(rp->sync);
+            int applied = record_apply_move(&ev, rp->gs);
+            writer_unlock(rp->sync);
+            if (applied == -1) {
+                return -1;
+            }
+            rp->moves++;
+            show_frame(rp);
+        } else if (ev.type == REC_KEYFRAME) {
+            rp->mismatches += !matches_keyframe(reader, &ev, rp->gs);
+        } else if (ev.type == REC_END) {
+            double elapsed = now_ms() - start_ms;
+            unsigned int played = rp->moves - first_move;
+            bool ok = matches_keyframe(reader, &ev, rp->gs);
+            rp->mismatches += !ok;
+            load_keyframe(rp, reader, &ev);
+            show_frame(rp);
+            wait_view(rp);
+
+            printf("Game %u (seed %u): %u moves in %.3f ms (%.0f moves/s)%s\n", game_number, start->seed, played,
+                   elapsed, (elapsed > 0) ? played * 1000.0 / elapsed : 0.0, ok ? "" : " - state mismatch");
+            for (unsigned int i = 0; i < rp->gs->num_players; i++) {
+                const player_t* p = &rp->gs->players[i];
+                printf("  %-16.16s %8u / %u / %u\n", p->name, p->score, p->valids, p->invalids);
+            }
+            return 0;
+        } else {
+            break; // REC_GAME: the master stopped before the game ended
+        }
+    }
+    wait_view(rp);
+    return -1;
+}
+
+int main(int argc, char *argv[]) {
+    replay_args_t args;
+    if (parse_replay_args(argc, argv, &args) == -1) {
+        exit(1);
+    }
+
+    record_reader_t reader;
+    if (record_reader_open(&reader, args.path) == -1) {
+        exit(1);
+    }
+    const record_header_t* header = reader.header;
+
+    replay_t rp;
+    memset(&rp, 0, sizeof(rp));
+    rp.view = -1;
+    shm_name(shm_names[0], SHM_NAME_LEN, SHM_STATE);
+    shm_name(shm_names[1], SHM_NAME_LEN, SHM_SYNC);
+    install_teardown();
+    rp.gs = allocate_game_state_shm(header->width, header->height, header->layout);
+    rp.sync = allocate_sync_shm();
+    if (rp.gs == NULL || rp.sync == NULL) {
+        fprintf(stderr, "Failed to allocate shared memory\n");
+        unlink_segments();
+        exit(1);
+    }
+    init_sync(rp.sync, RW_POLICY_FIFO);
+
+    int status = 0;
+    unsigned int game_number = 0;
+    record_event_t ev;
+    int r;
+    while ((r = record_next(&reader, &ev)) == 1) {
+        if (ev.type != REC_GAME) {
+            continue; // rest of a game skipped with -g
+        }
+        game_number++;
+        if (args.game != 0 && game_number != args.game) {
+            continue;
+        }
+        if (replay_game(&rp, &reader, &ev, &args, game_number) == -1) {
+            r = -1;
+            break;
+        }
+    }
+    if (r == -1) {
+        fprintf(stderr, "%s: corrupt or truncated recording\n", args.path);
+        status = 1;
+    }
+    if (rp.mismatches > 0) {
+        fprintf(stderr, "%u keyframes did not match the replayed state\n", rp.mismatches);
+        status = 1;
+    }
+
+    destroy_sync(rp.sync);
+    unlink_segments();
+    record_reader_close(&reader);
+    return status;
+}
@@ -0,0 +1,157 @@
+#include "ring.h"
+#include "sync.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+move_rings_t* allocate_move_rings_shm(unsigned int credits) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_MOVES);
+    size_t size = sizeof(move_rings_t);
+
+    int shm_fd = shm_open(name, O_CREAT | O_RDWR, 0777);
+    if (shm_fd == -1) {
+        perror("shm_open failed for move rings");
+        return NULL;
+    }
+
+    if (ftruncate(shm_fd, size) == -1) {
+        perror("ftruncate failed for move rings");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    move_rings_t* rings = (move_rings_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (rings == MAP_FAILED) {
+        perror("mmap failed for move rings");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    init_move_rings(rings, credits);
+
+    close(shm_fd);
+
+    return rings;
+}
+
+void init_move_rings(move_rings_t *rings, unsigned int credits) {
+    memset(rings, 0, sizeof(*rings));
+    rings->owner = getpid();
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        rings->rings[i].credits = credits;
+    }
+}
+
+move_rings_t* attach_move_rings_shm(void) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_MOVES);
+    int shm_fd = shm_open(name, O_RDWR, 0);
+    if (shm_fd == -1) {
+        return NULL;
+    }
+
+    move_rings_t* rings = (move_rings_t*)mmap(NULL, sizeof(move_rings_t), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (rings == MAP_FAILED) {
+        return NULL;
+    }
+    if (rings->owner != getppid()) {
+        munmap(rings, sizeof(move_rings_t));
+        return NULL;
+    }
+
+    return rings;
+}
+
+void cleanup_move_rings_shm(void) {
+    char name[SHM_NAME_LEN];
+    shm_name(name, sizeof(name), SHM_MOVES);
+    shm_unlink(name);
+}
+
+void move_ring_push(move_rings_t *rings, int id, unsigned char mov) {
+    move_ring_t *ring = &rings->rings[id];
+    unsigned int tail = ring->tail;
+    unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    while (tail - head >= MOVE_RING_SIZE) {
+        // Only reachable if the player holds more credits than slots
+        spin_while_equal(&ring->head, head);
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    }
+    ring->slots[tail & (MOVE_RING_SIZE - 1)] = mov;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    __atomic_add_fetch(&rings->doorbell, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&rings->master_waiting, __ATOMIC_SEQ_CST)) {
+        futex_wake(&rings->doorbell, 1);
+    }
+}
+
+void move_ring_take_credit(move_ring_t *ring) {
+    for (;;) {
+        unsigned int credits = __atomic_load_n(&ring->credits, __ATOMIC_ACQUIRE);
+        if (credits > 0) {
+            if (__atomic_compare_exchange_n(&ring->credits, &credits, credits - 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return;
+            }
+            continue;
+        }
+        if (spin_while_equal(&ring->credits, 0)) {
+            continue;
+        }
+        __atomic_store_n(&ring->credit_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->credits, __ATOMIC_SEQ_CST) == 0) {
+            futex_wait(&ring->credits, 0, -1);
+        }
+        __atomic_store_n(&ring->credit_waiting, 0, __ATOMIC_RELAXED);
+    }
+}
+
+void move_ring_close(move_rings_t *rings, int id) {
+    __atomic_store_n(&rings->rings[id].closed, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&rings->doorbell, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&rings->doorbell, 1);
+}
+
+int move_ring_pop(move_ring_t *ring, unsigned char *out, int max) {
+    unsigned int head = ring->head;
+    unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    int n = 0;
+    while (head != tail && n < max) {
+        out[n++] = ring->slots[head & (MOVE_RING_SIZE - 1)];
+        head++;
+    }
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+bool move_ring_has_data(move_ring_t *ring) {
+    return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) != ring->head;
+}
+
+void move_ring_grant_credit(move_ring_t *ring) {
+    __atomic_add_fetch(&ring->credits, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->credit_waiting, __ATOMIC_SEQ_CST)) {
+        futex_wake(&ring->credits, 1);
+    }
+}
+
+unsigned int move_rings_doorbell(move_rings_t *rings) {
+    return __atomic_load_n(&rings->doorbell, __ATOMIC_ACQUIRE);
+}
+
+void move_rings_wait(move_rings_t *rings, unsigned int seen, int timeout_ms) {
+    if (spin_while_equal(&rings->doorbell, seen)) {
+        return;
+    }
+    __atomic_store_n(&rings->master_waiting, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&rings->doorbell, __ATOMIC_SEQ_CST) == seen) {
+        futex_wait(&rings->doorbell, seen, timeout_ms);
+    }
+    __atomic_store_n(&rings->master_waiting, 0, __ATOMIC_RELAXED);
+}
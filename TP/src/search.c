@@ -0,0 +1,311 @@
+#include "search.h"
+#include "ai.h"
+#include "util.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TT_SIZE ((size_t)1 << SEARCH_TT_BITS)
+#define NODE_CHECK_MASK 255u        // check the clock every 256 interior nodes (and before every leaf)
+#define SCORE_INF (INT_MAX / 2)
+
+enum { TT_EXACT, TT_LOWER, TT_UPPER };
+
+typedef struct {
+    uint64_t key;
+    int score;
+    signed char depth;
+    signed char flag;
+    signed char move;       // best direction, -1 if none
+} tt_entry_t;
+
+typedef struct {
+    unsigned short x, y;
+    int value;              // cell value before the move
+} undo_t;
+
+// Per-thread search state: the private board and the transposition table are
+// allocated on first use and kept across moves.
+typedef struct {
+    game_state_t *board;
+    size_t board_size;
+    tt_entry_t *tt;
+    uint64_t hash;          // Zobrist hash of board (cells taken and both heads), side to move excluded
+    int side[2];            // player of each side: [0] searching player, [1] opponent or -1
+    long long deadline_ms;
+    unsigned long nodes;
+    bool aborted;
+    bool horizon;           // some leaf was cut by the depth limit (deeper search may differ)
+} search_t;
+
+static pthread_key_t search_key;
+static pthread_once_t search_once = PTHREAD_ONCE_INIT;
+
+static void search_free(void *arg) {
+    search_t *s = arg;
+    free(s->board);
+    free(s->tt);
+    free(s);
+}
+
+static void search_key_init(void) {
+    if (pthread_key_create(&search_key, search_free) != 0) {
+        perror("pthread_key_create");
+    }
+}
+
+static search_t *search_get(size_t board_size) {
+    pthread_once(&search_once, search_key_init);
+    search_t *s = pthread_getspecific(search_key);
+    if (s == NULL) {
+        s = calloc(1, sizeof(*s));
+        if (s == NULL) {
+            perror("calloc search state");
+            return NULL;
+        }
+        s->tt = calloc(TT_SIZE, sizeof(tt_entry_t));
+        if (s->tt == NULL || pthread_setspecific(search_key, s) != 0) {
+            perror("calloc transposition table");
+            free(s->tt);
+            free(s);
+            return NULL;
+        }
+    }
+    if (s->board_size < board_size) {
+        game_state_t *board = realloc(s->board, board_size);
+        if (board == NULL) {
+            perror("realloc search board");
+            return NULL;
+        }
+        s->board = board;
+        s->board_size = board_size;
+    }
+    return s;
+}
+
+// Zobrist keys derived from the cell index instead of a table, so boards of
+// any size cost no memory: kind 0 = cell taken, 1 + side = head of that side.
+static uint64_t zobrist(size_t cell, int kind) {
+    uint64_t z = (uint64_t)cell * 4 + (uint64_t)kind + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static const uint64_t SIDE_KEY = 0x5bd1e9955bd1e995ull;
+
+static size_t cell_index(const game_state_t *gs, int x, int y) {
+    return (size_t)y * gs->width + (size_t)x;
+}
+
+static uint64_t root_hash(const search_t *s) {
+    const game_state_t *gs = s->board;
+    uint64_t h = 0;
+    for (int y = 0; y < gs->height; y++) {
+        for (int x = 0; x < gs->width; x++) {
+            if (!is_free_cell(get_cell(gs, x, y))) h ^= zobrist(cell_index(gs, x, y), 0);
+        }
+    }
+    for (int side = 0; side < 2; side++) {
+        int p = s->side[side];
+        if (p >= 0) h ^= zobrist(cell_index(gs, gs->players[p].x, gs->players[p].y), 1 + side);
+    }
+    return h;
+}
+
+static void make_move(search_t *s, int side, int nx, int ny, undo_t *u) {
+    game_state_t *gs = s->board;
+    player_t *pl = &gs->players[s->side[side]];
+    u->x = pl->x;
+    u->y = pl->y;
+    u->value = get_cell(gs, nx, ny);
+
+    s->hash ^= zobrist(cell_index(gs, u->x, u->y), 1 + side)
+             ^ zobrist(cell_index(gs, nx, ny), 1 + side)
+             ^ zobrist(cell_index(gs, nx, ny), 0);
+    set_cell(gs, nx, ny, -s->side[side]);
+    pl->x = (unsigned short)nx;
+    pl->y = (unsigned short)ny;
+    pl->score += (unsigned int)u->value;
+}
+
+static void unmake_move(search_t *s, int side, const undo_t *u) {
+    game_state_t *gs = s->board;
+    player_t *pl = &gs->players[s->side[side]];
+    int nx = pl->x, ny = pl->y;
+
+    pl->score -= (unsigned int)u->value;
+    pl->x = u->x;
+    pl->y = u->y;
+    set_cell(gs, nx, ny, u->value);
+    s->hash ^= zobrist(cell_index(gs, u->x, u->y), 1 + side)
+             ^ zobrist(cell_index(gs, nx, ny), 1 + side)
+             ^ zobrist(cell_index(gs, nx, ny), 0);
+}
+
+// Legal directions of a side, with the transposition table's move first
+static int gen_moves(const search_t *s, int side, int first, int *dirs) {
+    const game_state_t *gs = s->board;
+    int p = s->side[side];
+    int n = 0;
+    if (p < 0) {
+        return 0;
+    }
+    for (int k = 0; k < 8; k++) {
+        int nx = gs->players[p].x + DIRS[k][0];
+        int ny = gs->players[p].y + DIRS[k][1];
+        if (in_bounds(gs, nx, ny) && is_free_cell(get_cell(gs, nx, ny))) {
+            dirs[n++] = k;
+        }
+    }
+    for (int i = 1; i < n; i++) {
+        if (dirs[i] == first) {
+            dirs[i] = dirs[0];
+            dirs[0] = first;
+            break;
+        }
+    }
+    return n;
+}
+
+// Leaf score from the searching player's point of view
+static int evaluate(const search_t *s) {
+    const game_state_t *gs = s->board;
+    int me = s->side[0], opp = s->side[1];
+    int cells[MAX_PLAYERS], value[MAX_PLAYERS];
+    unsigned int rivals = (opp >= 0) ? 1u << opp : 0;
+    if (evaluate_territory(gs, me, rivals, SEARCH_EVAL_RADIUS, cells, value) == -1) {
+        memset(value, 0, sizeof(value));
+    }
+    int score = (int)gs->players[me].score + value[me];
+    if (opp >= 0) {
+        score -= (int)gs->players[opp].score + value[opp];
+    }
+    return score;
+}
+
+static int negamax(search_t *s, int depth, int alpha, int beta, int side, int passes) {
+    if ((++s->nodes & NODE_CHECK_MASK) == 0 && monotonic_ms() >= s->deadline_ms) {
+        s->aborted = true;
+    }
+    if (s->aborted) {
+        return 0;
+    }
+    int sign = (side == 0) ? 1 : -1;
+    if (depth == 0 || passes == 2) {
+        if (monotonic_ms() >= s->deadline_ms) {
+            s->aborted = true;
+            return 0;
+        }
+        s->horizon = s->horizon || passes < 2;
+        return sign * evaluate(s);
+    }
+
+    uint64_t key = s->hash ^ ((side == 0) ? 0 : SIDE_KEY);
+    tt_entry_t *entry = &s->tt[key & (TT_SIZE - 1)];
+    int tt_move = -1;
+    if (entry->key == key) {
+        tt_move = entry->move;
+        if (entry->depth >= depth) {
+            s->horizon = true;  // unknown for the stored subtree: assume it was cut
+            if (entry->flag == TT_EXACT) return entry->score;
+            if (entry->flag == TT_LOWER && entry->score >= beta) return entry->score;
+            if (entry->flag == TT_UPPER && entry->score <= alpha) return entry->score;
+        }
+    }
+
+    int dirs[8];
+    int n = gen_moves(s, side, tt_move, dirs);
+    if (n == 0) {
+        // Stuck (or absent) side: the other one keeps playing
+        return -negamax(s, depth - 1, -beta, -alpha, 1 - side, passes + 1);
+    }
+
+    int alpha_in = alpha;
+    int best = -SCORE_INF, best_move = -1;
+    for (int i = 0; i < n; i++) {
+        const game_state_t *gs = s->board;
+        int p = s->side[side];
+        undo_t u;
+        make_move(s, side, gs->players[p].x + DIRS[dirs[i]][0], gs->players[p].y + DIRS[dirs[i]][1], &u);
+        int score = -negamax(s, depth - 1, -beta, -alpha, 1 - side, 0);
+        unmake_move(s, side, &u);
+        if (s->aborted) {
+            return 0;
+        }
+        if (score > best) {
+            best = score;
+            best_move = dirs[i];
+        }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) break;
+    }
+
+    entry->key = key;
+    entry->score = best;
+    entry->depth = (signed char)depth;
+    entry->move = (signed char)best_move;
+    entry->flag = (best <= alpha_in) ? TT_UPPER : (best >= beta) ? TT_LOWER : TT_EXACT;
+    return best;
+}
+
+int choose_best_move_search(int *move, const game_state_t *gs, sync_t *sync, int id) {
+    long long start_ms = monotonic_ms();
+    size_t size = game_state_size(gs->width, gs->height, board_layout(gs));
+    search_t *s = search_get(size);
+    if (s == NULL) {
+        return choose_best_move(move, gs, sync, id);
+    }
+    if (sync != NULL) {
+        snapshot_game_state(s->board, gs, sync);
+    } else {
+        memcpy(s->board, gs, size);
+    }
+
+    s->side[0] = id;
+    s->side[1] = ai_nearest_opponent(s->board, id);
+    s->hash = root_hash(s);
+    s->deadline_ms = LLONG_MAX;     // depth 1 (at most 8 bounded leaves) always completes
+    s->aborted = false;
+    s->nodes = 0;
+
+    int dirs[8];
+    int best_dir = -1;
+    int n = gen_moves(s, 0, -1, dirs);
+    if (n == 0) {
+        return -1;
+    }
+    if (n == 1) {
+        best_dir = dirs[0];
+    }
+
+    bool horizon = true;
+    for (int depth = 1; n > 1 && horizon && depth <= SEARCH_MAX_DEPTH; depth++) {
+        gen_moves(s, 0, best_dir, dirs);
+        s->horizon = false;
+        int alpha = -SCORE_INF, iteration_best = -1;
+        for (int i = 0; i < n; i++) {
+            const game_state_t *b = s->board;
+            undo_t u;
+            make_move(s, 0, b->players[id].x + DIRS[dirs[i]][0], b->players[id].y + DIRS[dirs[i]][1], &u);
+            int score = -negamax(s, depth - 1, -SCORE_INF, -alpha, 1, 0);
+            unmake_move(s, 0, &u);
+            if (s->aborted) break;
+            if (score > alpha || iteration_best < 0) {
+                alpha = score;
+                iteration_best = dirs[i];
+            }
+        }
+        if (s->aborted) {
+            break;  // keep the move of the last completed depth
+        }
+        best_dir = iteration_best;
+        horizon = s->horizon;   // the whole game tree fit: deeper iterations would repeat it
+        s->deadline_ms = start_ms + ai_time_budget_ms();
+    }
+    move[0] = DIRS[best_dir][0];
+    move[1] = DIRS[best_dir][1];
+    return 0;
+}
@@ -1,16 +1,79 @@
+#define _GNU_SOURCE
 #include "common.h"
 #include "sync.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
 
-void init_sync(sync_t *s) {
+#define SPIN_MIN 16
+#define SPIN_MAX 4096
+
+static unsigned int spin_budget = 256;   // adaptive spin count of spin_while_equal()
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+void init_sync(sync_t *s, rw_policy_t policy) {
     sem_init(&s->drawing_signal, 1, 0);
     sem_init(&s->not_drawing_signal, 1, 0);
     sem_init(&s->accessor_queue_signal, 1, 1);
     sem_init(&s->full_access_signal, 1, 1);
     sem_init(&s->reader_count_protect_signal, 1, 1);
     s->reader_count = 0;
+    s->state_seq = 0;
+    s->rw_state = 0;
+    s->rw_ticket_next = 0;
+    s->rw_ticket_serving = 0;
+    s->rw_ticket_sleepers = 0;
+    s->rw_policy = policy;
+    s->move_credits = 1;
+    s->players_reused = 0;
+    s->game_generation = 0;
+    s->players_shutdown = 0;
+    s->view_async = 0;
+    s->view_generation = 0;
+    s->view_waiting = 0;
+    s->view_frame_ms = 0;
     for (int i = 0; i < MAX_PLAYERS; i++) {
         sem_init(&s->move_signal[i], 1, 1);
+        s->player_game_ack[i] = 0;
+    }
+}
+
+void publish_view_frame(sync_t *s) {
+    __atomic_add_fetch(&s->view_generation, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s->view_waiting, __ATOMIC_SEQ_CST)) {
+        futex_wake(&s->view_generation, 1);
+    }
+}
+
+unsigned int wait_view_frame(sync_t *s, unsigned int seen) {
+    unsigned int generation = __atomic_load_n(&s->view_generation, __ATOMIC_ACQUIRE);
+    while (generation == seen) {
+        __atomic_store_n(&s->view_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&s->view_generation, __ATOMIC_SEQ_CST) == seen) {
+            futex_wait(&s->view_generation, seen, -1);
+        }
+        __atomic_store_n(&s->view_waiting, 0, __ATOMIC_RELAXED);
+        generation = __atomic_load_n(&s->view_generation, __ATOMIC_ACQUIRE);
     }
+    return generation;
+}
+
+void set_move_credits(sync_t *s, unsigned int credits) {
+    for (unsigned int c = s->move_credits; c < credits; c++) {
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+            sem_post(&s->move_signal[i]);
+        }
+    }
+    s->move_credits = credits;
 }
 
 void destroy_sync(sync_t *s) {
@@ -24,6 +87,20 @@ void destroy_sync(sync_t *s) {
     }
 }
 
+#ifdef SYNC_SEMAPHORE_RWLOCK
+
+/* ========= legacy rwlock: three POSIX semaphores ========= */
+
+static void rw_acquire_write(sync_t *s) {
+    sem_wait(&s->accessor_queue_signal);
+    sem_wait(&s->full_access_signal);
+}
+
+static void rw_release_write(sync_t *s) {
+    sem_post(&s->full_access_signal);
+    sem_post(&s->accessor_queue_signal);
+}
+
 void reader_lock(sync_t *s) {
     sem_wait(&s->accessor_queue_signal);
 
@@ -46,12 +123,213 @@ void reader_unlock(sync_t *s) {
     sem_post(&s->reader_count_protect_signal);
 }
 
-void writer_lock(sync_t *s) {
+#else
+
+/* ========= futex rwlock: one state word, syscalls only under contention =========
+ * rw_state = reader count | RW_WRITER | RW_WRITER_WAITING | RW_SLEEPERS.
+ * FIFO policy adds a ticket queue (rw_ticket_next / rw_ticket_serving) in front
+ * of the state word; the other policies only differ in whether a waiting
+ * writer holds back new readers.
+ */
+
+#define RW_WRITER         0x80000000u
+#define RW_WRITER_WAITING 0x40000000u
+#define RW_SLEEPERS       0x20000000u
+#define RW_READERS        0x1fffffffu
+
+static bool rw_sleep(sync_t *s, unsigned int state) {
+    if (spin_while_equal(&s->rw_state, state)) {
+        return false;
+    }
+    if (!(state & RW_SLEEPERS)) {
+        if (!__atomic_compare_exchange_n(&s->rw_state, &state, state | RW_SLEEPERS, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+    }
+    futex_wait(&s->rw_state, state | RW_SLEEPERS, -1);
+    return true;
+}
+
+static void rw_acquire_read(sync_t *s, bool yield_to_writers) {
+    for (;;) {
+        unsigned int state = __atomic_load_n(&s->rw_state, __ATOMIC_ACQUIRE);
+        bool blocked = (state & RW_WRITER) || (yield_to_writers && (state & RW_WRITER_WAITING));
+        if (!blocked) {
+            if (__atomic_compare_exchange_n(&s->rw_state, &state, state + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return;
+            }
+            continue;
+        }
+        rw_sleep(s, state);
+    }
+}
+
+static void rw_acquire_exclusive(sync_t *s, bool announce) {
+    for (;;) {
+        unsigned int state = __atomic_load_n(&s->rw_state, __ATOMIC_ACQUIRE);
+        if ((state & (RW_WRITER | RW_READERS)) == 0) {
+            unsigned int locked = (state | RW_WRITER) & ~RW_WRITER_WAITING;
+            if (__atomic_compare_exchange_n(&s->rw_state, &state, locked, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return;
+            }
+            continue;
+        }
+        if (announce && !(state & RW_WRITER_WAITING)) {
+            __atomic_compare_exchange_n(&s->rw_state, &state, state | RW_WRITER_WAITING, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            continue;
+        }
+        rw_sleep(s, state);
+    }
+}
+
+static void rw_release_read(sync_t *s) {
+    unsigned int state = __atomic_sub_fetch(&s->rw_state, 1, __ATOMIC_RELEASE);
+    if ((state & RW_READERS) == 0 && (state & RW_SLEEPERS)) {
+        __atomic_fetch_and(&s->rw_state, ~RW_SLEEPERS, __ATOMIC_RELAXED);
+        futex_wake(&s->rw_state, INT_MAX);
+    }
+}
+
+static void rw_release_exclusive(sync_t *s) {
+    unsigned int state = __atomic_fetch_and(&s->rw_state, ~(RW_WRITER | RW_SLEEPERS), __ATOMIC_RELEASE);
+    if (state & RW_SLEEPERS) {
+        futex_wake(&s->rw_state, INT_MAX);
+    }
+}
+
+static unsigned int ticket_take(sync_t *s) {
+    unsigned int ticket = __atomic_fetch_add(&s->rw_ticket_next, 1, __ATOMIC_ACQ_REL);
+    for (;;) {
+        unsigned int serving = __atomic_load_n(&s->rw_ticket_serving, __ATOMIC_ACQUIRE);
+        if (serving == ticket) {
+            return ticket;
+        }
+        if (spin_while_equal(&s->rw_ticket_serving, serving)) {
+            continue;
+        }
+        __atomic_add_fetch(&s->rw_ticket_sleepers, 1, __ATOMIC_SEQ_CST);
+        futex_wait(&s->rw_ticket_serving, serving, -1);
+        __atomic_sub_fetch(&s->rw_ticket_sleepers, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void ticket_next(sync_t *s) {
+    __atomic_add_fetch(&s->rw_ticket_serving, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s->rw_ticket_sleepers, __ATOMIC_SEQ_CST) > 0) {
+        futex_wake(&s->rw_ticket_serving, INT_MAX);
+    }
+}
+
+/* The writer also takes the semaphores of the original protocol, in the same
+ * order as the legacy writer, so view/player binaries built against it (which
+ * only know full_access_signal) are still excluded while the state changes.
+ * Uncontended, sem_wait()/sem_post() stay in user space. */
+static void rw_acquire_write(sync_t *s) {
+    switch (s->rw_policy) {
+    case RW_POLICY_FIFO:
+        ticket_take(s);
+        rw_acquire_exclusive(s, false);
+        break; // the ticket is passed on in rw_release_write()
+    case RW_POLICY_WRITER:
+        rw_acquire_exclusive(s, true);
+        break;
+    default:
+        rw_acquire_exclusive(s, false);
+        break;
+    }
     sem_wait(&s->accessor_queue_signal);
     sem_wait(&s->full_access_signal);
 }
 
-void writer_unlock(sync_t *s) {
+static void rw_release_write(sync_t *s) {
     sem_post(&s->full_access_signal);
     sem_post(&s->accessor_queue_signal);
+    rw_release_exclusive(s);
+    if (s->rw_policy == RW_POLICY_FIFO) {
+        ticket_next(s);
+    }
+}
+
+void reader_lock(sync_t *s) {
+    switch (s->rw_policy) {
+    case RW_POLICY_FIFO:
+        ticket_take(s);
+        rw_acquire_read(s, false);
+        ticket_next(s); // readers behind us may enter concurrently
+        break;
+    case RW_POLICY_WRITER:
+        rw_acquire_read(s, true);
+        break;
+    default:
+        rw_acquire_read(s, false);
+        break;
+    }
+}
+
+void reader_unlock(sync_t *s) {
+    rw_release_read(s);
+}
+
+#endif
+
+void writer_lock(sync_t *s) {
+    rw_acquire_write(s);
+    __atomic_add_fetch(&s->state_seq, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void writer_unlock(sync_t *s) {
+    __atomic_add_fetch(&s->state_seq, 1, __ATOMIC_RELEASE);
+    rw_release_write(s);
+}
+
+int parse_rw_policy(const char *name, rw_policy_t *policy) {
+    if (strcmp(name, "reader") == 0) {
+        *policy = RW_POLICY_READER;
+    } else if (strcmp(name, "writer") == 0) {
+        *policy = RW_POLICY_WRITER;
+    } else if (strcmp(name, "fifo") == 0) {
+        *policy = RW_POLICY_FIFO;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int futex_wait(unsigned int *addr, unsigned int expected, int timeout_ms) {
+    struct timespec ts;
+    struct timespec *tsp = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        tsp = &ts;
+    }
+    long rc = syscall(SYS_futex, addr, FUTEX_WAIT, expected, tsp, NULL, 0);
+    if (rc == -1 && errno == EAGAIN) {
+        return 0;
+    }
+    return rc == 0 ? 0 : -1;
+}
+
+void futex_wake(unsigned int *addr, int count) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+bool spin_while_equal(const unsigned int *addr, unsigned int value) {
+    // Shared by every thread of the process (e.g. the master's pool and event
+    // threads): relaxed atomics, as it is only a hint
+    unsigned int budget = __atomic_load_n(&spin_budget, __ATOMIC_RELAXED);
+    for (unsigned int i = 0; i < budget; i++) {
+        if (__atomic_load_n(addr, __ATOMIC_ACQUIRE) != value) {
+            if (budget < SPIN_MAX) {
+                __atomic_store_n(&spin_budget, budget * 2, __ATOMIC_RELAXED);
+            }
+            return true;
+        }
+        cpu_relax();
+    }
+    if (budget > SPIN_MIN) {
+        __atomic_store_n(&spin_budget, budget / 2, __ATOMIC_RELAXED);
+    }
+    return false;
 }
@@ -1,7 +1,17 @@
+#define _POSIX_C_SOURCE 200809L
 #include "util.h"
 #include "common.h"
 #include <fcntl.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(NO_SIMD)
+#define UTIL_SIMD
+#include <immintrin.h>
+#endif
+
+enum { ISA_SCALAR, ISA_SSE2, ISA_AVX2 };
 
 unsigned char direction_to_char(const int direction[2]) {
     for (int i = 0; i < 8; i++) {
@@ -20,9 +30,6 @@ bool in_bounds(const game_state_t *gs, int x, int y) {
     return x >= 0 && y >= 0 && x < (int)gs->width && y < (int)gs->height;
 }
 
-int get_cell(const game_state_t *gs, int x, int y) {
-    return gs->board[y * gs->width + x];
-}
 
 int count_free_neighbors(const game_state_t *gs, int x, int y) {
     int count = 0;
@@ -36,6 +43,264 @@ int count_free_neighbors(const game_state_t *gs, int x, int y) {
     return count;
 }
 
+// Cells player p took since the last sync, walked from its previous head: each
+// one holds -p and is still free for the caller, and only p writes -p.
+static int player_trail(const board_delta_t *delta, const game_state_t *gs, int p,
+                        bool (*was_free)(const void *ctx, int x, int y), const void *ctx, int *cells, int max) {
+    int n = 0, head = 0;
+    int x = delta->x[p], y = delta->y[p];
+    for (;;) {
+        for (int k = 0; k < 8; k++) {
+            int nx = x + DIRS[k][0];
+            int ny = y + DIRS[k][1];
+            if (!in_bounds(gs, nx, ny) || get_cell(gs, nx, ny) != -p || !was_free(ctx, nx, ny)) continue;
+            int cell = ny * gs->width + nx;
+            bool seen = false;
+            for (int i = 0; i < n && !seen; i++) seen = cells[i] == cell;
+            if (seen) continue;
+            if (n == max) return -1;
+            cells[n++] = cell;
+        }
+        if (head == n) return n;
+        x = cells[head] % gs->width;
+        y = cells[head] / gs->width;
+        head++;
+    }
+}
+
+int board_delta(board_delta_t *delta, const game_state_t *gs, bool (*was_free)(const void *ctx, int x, int y),
+                const void *ctx, int *cells, int max) {
+    int n = (delta->gs == gs && delta->num_players == gs->num_players) ? 0 : -1;
+    for (unsigned int p = 0; n >= 0 && p < gs->num_players; p++) {
+        const player_t *player = &gs->players[p];
+        unsigned int moves = player->valids - delta->valids[p];
+        if (moves == 0) {
+            n = (player->x == delta->x[p] && player->y == delta->y[p]) ? n : -1;
+        } else if (moves > (unsigned int)(max - n)) {
+            n = -1;     // a new game (valids went back) or too many cells
+        } else {
+            int taken = player_trail(delta, gs, (int)p, was_free, ctx, cells + n, max - n);
+            bool reaches_head = false;
+            for (int i = 0; i < taken && !reaches_head; i++) {
+                reaches_head = cells[n + i] == player->y * gs->width + player->x;
+            }
+            n = (taken == (int)moves && reaches_head) ? n + taken : -1;
+        }
+    }
+
+    delta->gs = gs;
+    delta->num_players = gs->num_players;
+    for (unsigned int p = 0; p < gs->num_players; p++) {
+        delta->valids[p] = gs->players[p].valids;
+        delta->x[p] = gs->players[p].x;
+        delta->y[p] = gs->players[p].y;
+    }
+    return n;
+}
+
+static int simd_level(void) {
+#ifdef UTIL_SIMD
+    if (__builtin_cpu_supports("avx2")) return ISA_AVX2;
+    if (__builtin_cpu_supports("sse2")) return ISA_SSE2;
+#endif
+    return ISA_SCALAR;
+}
+
+// flags[x] = 1 if cell (x, y) is free, for x in [from, width)
+static void free_flags_scalar(const game_state_t *gs, int y, uint8_t *flags, int from) {
+    int width = gs->width;
+    if (board_layout(gs) == BOARD_LAYOUT_V2) {
+        const int8_t *cells = board_row(gs, y);
+        for (int x = from; x < width; x++) flags[x] = (uint8_t)(cells[x] >= 1 && cells[x] <= 9);
+    } else {
+        const int *cells = board_row(gs, y);
+        for (int x = from; x < width; x++) flags[x] = (uint8_t)(cells[x] >= 1 && cells[x] <= 9);
+    }
+}
+
+// sums[x] = flags[x - 1] + flags[x] + flags[x + 1] (flags padded by one byte on each side)
+static void row_sums_scalar(const uint8_t *flags, uint8_t *sums, int from, int width) {
+    for (int x = from; x < width; x++) sums[x] = (uint8_t)(flags[x] + flags[x + 1] + flags[x + 2]);
+}
+
+// 3x3 sum minus the cell itself
+static void combine_scalar(const uint8_t *up, const uint8_t *mid, const uint8_t *down,
+                           const uint8_t *flags, uint8_t *out, int from, int width) {
+    for (int x = from; x < width; x++) out[x] = (uint8_t)(up[x] + mid[x] + down[x] - flags[x + 1]);
+}
+
+#ifdef UTIL_SIMD
+__attribute__((target("avx2")))
+static int free_flags_avx2(const game_state_t *gs, int y, uint8_t *flags) {
+    int width = gs->width, x = 0;
+    const __m256i one = _mm256_set1_epi8(1);
+    if (board_layout(gs) == BOARD_LAYOUT_V2) {
+        const int8_t *cells = board_row(gs, y);
+        const __m256i zero = _mm256_setzero_si256(), ten = _mm256_set1_epi8(10);
+        for (; x + 32 <= width; x += 32) {
+            __m256i c = _mm256_loadu_si256((const __m256i *)(const void *)(cells + x));
+            __m256i is_free = _mm256_and_si256(_mm256_cmpgt_epi8(c, zero), _mm256_cmpgt_epi8(ten, c));
+            _mm256_storeu_si256((__m256i *)(void *)(flags + x), _mm256_and_si256(is_free, one));
+        }
+    } else {
+        const int *cells = board_row(gs, y);
+        const __m256i zero = _mm256_setzero_si256(), ten = _mm256_set1_epi32(10);
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        for (; x + 32 <= width; x += 32) {
+            __m256i m[4];
+            for (int k = 0; k < 4; k++) {
+                __m256i c = _mm256_loadu_si256((const __m256i *)(const void *)(cells + x + 8 * k));
+                m[k] = _mm256_and_si256(_mm256_cmpgt_epi32(c, zero), _mm256_cmpgt_epi32(ten, c));
+            }
+            // Saturating packs keep the 0/-1 masks; they interleave 128-bit lanes, hence the permute
+            __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(m[0], m[1]), _mm256_packs_epi32(m[2], m[3]));
+            packed = _mm256_permutevar8x32_epi32(packed, order);
+            _mm256_storeu_si256((__m256i *)(void *)(flags + x), _mm256_and_si256(packed, one));
+        }
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int row_sums_avx2(const uint8_t *flags, uint8_t *sums, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i left  = _mm256_loadu_si256((const __m256i *)(const void *)(flags + x));
+        __m256i mid   = _mm256_loadu_si256((const __m256i *)(const void *)(flags + x + 1));
+        __m256i right = _mm256_loadu_si256((const __m256i *)(const void *)(flags + x + 2));
+        _mm256_storeu_si256((__m256i *)(void *)(sums + x), _mm256_add_epi8(_mm256_add_epi8(left, mid), right));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int combine_avx2(const uint8_t *up, const uint8_t *mid, const uint8_t *down,
+                        const uint8_t *flags, uint8_t *out, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i sum = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(const void *)(up + x)),
+                                      _mm256_loadu_si256((const __m256i *)(const void *)(mid + x)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(const void *)(down + x)));
+        sum = _mm256_sub_epi8(sum, _mm256_loadu_si256((const __m256i *)(const void *)(flags + x + 1)));
+        _mm256_storeu_si256((__m256i *)(void *)(out + x), sum);
+    }
+    return x;
+}
+
+__attribute__((target("sse2")))
+static int free_flags_sse2(const game_state_t *gs, int y, uint8_t *flags) {
+    int width = gs->width, x = 0;
+    const __m128i one = _mm_set1_epi8(1);
+    if (board_layout(gs) == BOARD_LAYOUT_V2) {
+        const int8_t *cells = board_row(gs, y);
+        const __m128i zero = _mm_setzero_si128(), ten = _mm_set1_epi8(10);
+        for (; x + 16 <= width; x += 16) {
+            __m128i c = _mm_loadu_si128((const __m128i *)(const void *)(cells + x));
+            __m128i is_free = _mm_and_si128(_mm_cmpgt_epi8(c, zero), _mm_cmpgt_epi8(ten, c));
+            _mm_storeu_si128((__m128i *)(void *)(flags + x), _mm_and_si128(is_free, one));
+        }
+    } else {
+        const int *cells = board_row(gs, y);
+        const __m128i zero = _mm_setzero_si128(), ten = _mm_set1_epi32(10);
+        for (; x + 16 <= width; x += 16) {
+            __m128i m[4];
+            for (int k = 0; k < 4; k++) {
+                __m128i c = _mm_loadu_si128((const __m128i *)(const void *)(cells + x + 4 * k));
+                m[k] = _mm_and_si128(_mm_cmpgt_epi32(c, zero), _mm_cmpgt_epi32(ten, c));
+            }
+            __m128i packed = _mm_packs_epi16(_mm_packs_epi32(m[0], m[1]), _mm_packs_epi32(m[2], m[3]));
+            _mm_storeu_si128((__m128i *)(void *)(flags + x), _mm_and_si128(packed, one));
+        }
+    }
+    return x;
+}
+
+__attribute__((target("sse2")))
+static int row_sums_sse2(const uint8_t *flags, uint8_t *sums, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i left  = _mm_loadu_si128((const __m128i *)(const void *)(flags + x));
+        __m128i mid   = _mm_loadu_si128((const __m128i *)(const void *)(flags + x + 1));
+        __m128i right = _mm_loadu_si128((const __m128i *)(const void *)(flags + x + 2));
+        _mm_storeu_si128((__m128i *)(void *)(sums + x), _mm_add_epi8(_mm_add_epi8(left, mid), right));
+    }
+    return x;
+}
+
+__attribute__((target("sse2")))
+static int combine_sse2(const uint8_t *up, const uint8_t *mid, const uint8_t *down,
+                        const uint8_t *flags, uint8_t *out, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i *)(const void *)(up + x)),
+                                   _mm_loadu_si128((const __m128i *)(const void *)(mid + x)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(const void *)(down + x)));
+        sum = _mm_sub_epi8(sum, _mm_loadu_si128((const __m128i *)(const void *)(flags + x + 1)));
+        _mm_storeu_si128((__m128i *)(void *)(out + x), sum);
+    }
+    return x;
+}
+#endif
+
+// Fills the padded flag row and the horizontal sums of row y (zeros outside the board)
+static void load_map_row(const game_state_t *gs, int isa, int y, uint8_t *flags, uint8_t *sums) {
+    int width = gs->width;
+    if (y < 0 || y >= gs->height) {
+        memset(flags, 0, (size_t)width + 2);
+        memset(sums, 0, (size_t)width);
+        return;
+    }
+    int done = 0;
+#ifndef UTIL_SIMD
+    (void)isa;
+#else
+    if (isa == ISA_AVX2) done = free_flags_avx2(gs, y, flags + 1);
+    else if (isa == ISA_SSE2) done = free_flags_sse2(gs, y, flags + 1);
+#endif
+    free_flags_scalar(gs, y, flags + 1, done);
+    flags[0] = 0;
+    flags[width + 1] = 0;
+
+    done = 0;
+#ifdef UTIL_SIMD
+    if (isa == ISA_AVX2) done = row_sums_avx2(flags, sums, width);
+    else if (isa == ISA_SSE2) done = row_sums_sse2(flags, sums, width);
+#endif
+    row_sums_scalar(flags, sums, done, width);
+}
+
+void free_neighbor_map(const game_state_t *gs, uint8_t *counts, uint8_t *scratch, int y0, int y1) {
+    int width = gs->width;
+    if (y0 < 0) y0 = 0;
+    if (y1 > gs->height) y1 = gs->height;
+    if (y0 >= y1) {
+        return;
+    }
+
+    // Three rolling rows (above, current, below) of flags and horizontal sums
+    size_t flag_row = (size_t)width + 2;
+    uint8_t *flags[3], *sums[3];
+    for (int i = 0; i < 3; i++) {
+        flags[i] = scratch + (size_t)i * flag_row;
+        sums[i] = scratch + 3 * flag_row + (size_t)i * width;
+    }
+
+    int isa = simd_level();
+    load_map_row(gs, isa, y0 - 1, flags[(y0 + 2) % 3], sums[(y0 + 2) % 3]);
+    load_map_row(gs, isa, y0, flags[y0 % 3], sums[y0 % 3]);
+    for (int y = y0; y < y1; y++) {
+        int up = (y + 2) % 3, mid = y % 3, down = (y + 1) % 3;
+        load_map_row(gs, isa, y + 1, flags[down], sums[down]);
+        uint8_t *out = counts + (size_t)(y - y0) * width;
+        int done = 0;
+#ifdef UTIL_SIMD
+        if (isa == ISA_AVX2) done = combine_avx2(sums[up], sums[mid], sums[down], flags[mid], out, width);
+        else if (isa == ISA_SSE2) done = combine_sse2(sums[up], sums[mid], sums[down], flags[mid], out, width);
+#endif
+        combine_scalar(sums[up], sums[mid], sums[down], flags[mid], out, done, width);
+    }
+}
+
 bool is_valid_move(int player_pos, int new_x, int new_y, game_state_t* gs) {
     if (new_x < 0 || new_x >= gs->width || new_y < 0 || new_y >= gs->height) {
         return false;
@@ -51,7 +316,7 @@ bool is_valid_move(int player_pos, int new_x, int new_y, game_state_t* gs) {
         return false;
     }
     
-    int cell_value = gs->board[new_y * gs->width + new_x];
+    int cell_value = get_cell(gs, new_x, new_y);
     return is_free_cell(cell_value);
 }
 
@@ -60,3 +325,15 @@ long calculate_time_diff_ms(struct timespec start, struct timespec end) {
     long nanoseconds = end.tv_nsec - start.tv_nsec;
     return seconds * 1000 + nanoseconds / 1000000;
 }
+
+long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -21,6 +21,7 @@ typedef struct {
     int board_y, board_x; // origen tablero
     int xmul, ymul;       // “multipixel” por celda
     int w_real, h_real;   // rectángulo del tablero (incluye borde)
+    int vis_w, vis_h;     // celdas que entran en la terminal
 } layout_t;
 
 void compute_layout(layout_t *ly, const game_state_t *gs) {
@@ -53,6 +54,14 @@ void compute_layout(layout_t *ly, const game_state_t *gs) {
         ly->board_y = ly->rows - ly->h_real;
         if (ly->board_y < 0) ly->board_y = 0;
     }
+
+    // Tableros más grandes que la terminal: no se dibuja lo que queda afuera
+    ly->vis_w = (ly->cols - ly->board_x - 1) / ly->xmul;
+    ly->vis_h = (ly->rows - ly->board_y - 1) / ly->ymul;
+    if (ly->vis_w > (int)gs->width)  ly->vis_w = (int)gs->width;
+    if (ly->vis_h > (int)gs->height) ly->vis_h = (int)gs->height;
+    if (ly->vis_w < 0) ly->vis_w = 0;
+    if (ly->vis_h < 0) ly->vis_h = 0;
 }
 
 /* ========= UI / colores ========= */
@@ -132,6 +141,7 @@ static void draw_players_info(const game_state_t *gs){
                  gs->players[i].invalids,
                  gs->players[i].x, gs->players[i].y,
                  gs->players[i].blocked ? "blocked" : "ok");
+        clrtoeol(); // sin clear() por frame: "ok" pisa a "blocked"
     }
 }
 
@@ -155,46 +165,69 @@ static void draw_board_frame(const layout_t *ly){
     attroff(COLOR_PAIR(3));
 }
 
-static void fill_cell_rect(const layout_t *ly, int cx, int cy, int pair, chtype center_char, int emphasize_bold){
-    int sx = ly->board_x + 1 + cx * ly->xmul;
-    int sy = ly->board_y + 1 + cy * ly->ymul;
+/* Atributos + carácter de una celda tal como se ve en pantalla */
+static chtype cell_look(const game_state_t *gs, int x, int y, int *head_of){
+    for (unsigned i=0; i<gs->num_players; i++){
+        if (gs->players[i].x == x && gs->players[i].y == y) {
+            *head_of = (int)i;
+            return ' ' | COLOR_PAIR(31 + (int)i*2) | A_BOLD; // cabeza: relleno completo, bold
+        }
+    }
+    *head_of = -1;
+    int v = get_cell(gs, x, y);
+    if (is_free_cell(v))
+        return (chtype)('0' + (v % 10)) | COLOR_PAIR(1) | A_DIM; // recompensa
+    return ' ' | COLOR_PAIR(30 + owner_from_v(v)*2);            // territorio
+}
 
-    if (emphasize_bold) attron(A_BOLD);
-    attron(COLOR_PAIR(pair));
+/* Una fila de pantalla del rectángulo de una celda: centro con el dígito, resto relleno */
+static void cell_row(chtype *out, const layout_t *ly, chtype look, int r){
+    chtype fill = (look & ~A_CHARTEXT) | ' ';
+    for (int c=0; c<ly->xmul; c++){
+        int is_center = (r == ly->ymul/2) && (c == ly->xmul/2);
+        out[c] = is_center ? look : fill;
+    }
+}
 
+static void draw_cell(const layout_t *ly, const game_state_t *gs, int cx, int cy){
+    int head_of;
+    chtype look = cell_look(gs, cx, cy, &head_of);
+    chtype row[8];
+    int sx = ly->board_x + 1 + cx * ly->xmul;
+    int sy = ly->board_y + 1 + cy * ly->ymul;
     for (int r=0; r<ly->ymul; r++){
-        for (int c=0; c<ly->xmul; c++){
-            int is_center = (r == ly->ymul/2) && (c == ly->xmul/2);
-            mvaddch(sy + r, sx + c, is_center ? center_char : ' ');
-        }
+        cell_row(row, ly, look, r);
+        mvaddchnstr(sy + r, sx, row, ly->xmul);
     }
-
-    attroff(COLOR_PAIR(pair));
-    if (emphasize_bold) attroff(A_BOLD);
 }
 
-static void draw_board(const layout_t *ly, const game_state_t *gs){
-    // terreno / recompensas
-    for (int y=0; y<(int)gs->height; y++){
-        for (int x=0; x<(int)gs->width; x++){
-            int v = get_cell(gs, x, y);
-            if (is_free_cell(v)) {
-                attron(COLOR_PAIR(1) | A_DIM);
-                fill_cell_rect(ly, x, y, 1, (chtype)('0' + (v % 10)), 0);
-                attroff(COLOR_PAIR(1) | A_DIM);
-            } else {
-                int id   = owner_from_v(v);
-                int base = 30 + id*2;    // territorio
-                fill_cell_rect(ly, x, y, base, ' ', 0);
+/* Tablero completo: una escritura por fila de pantalla */
+static void draw_board(const layout_t *ly, const game_state_t *gs, chtype *line){
+    for (int y=0; y<ly->vis_h; y++){
+        for (int r=0; r<ly->ymul; r++){
+            for (int x=0; x<ly->vis_w; x++){
+                int head_of;
+                cell_row(&line[x * ly->xmul], ly, cell_look(gs, x, y, &head_of), r);
             }
+            mvaddchnstr(ly->board_y + 1 + y * ly->ymul + r, ly->board_x + 1, line, ly->vis_w * ly->xmul);
+        }
+    }
+}
+
+/* Solo las celdas que cambiaron desde el último frame (valor o cabeza) */
+static void draw_board_dirty(const layout_t *ly, const game_state_t *gs, const game_state_t *prev){
+    for (int y=0; y<ly->vis_h; y++){
+        if (memcmp(board_row(gs, y), board_row(prev, y), (size_t)ly->vis_w * board_cell_size(gs)) == 0) continue;
+        for (int x=0; x<ly->vis_w; x++){
+            if (get_cell(gs, x, y) != get_cell(prev, x, y)) draw_cell(ly, gs, x, y);
         }
     }
-    // cabezas
     for (unsigned i=0; i<gs->num_players; i++){
-        int px = gs->players[i].x, py = gs->players[i].y;
-        if (!in_bounds(gs, px, py)) continue;
-        int head = 31 + (int)i*2;        // par de cabeza
-        fill_cell_rect(ly, px, py, head, ' ', 1); // relleno completo; bold para “levantar” el tono
+        int ox = prev->players[i].x, oy = prev->players[i].y;
+        int nx = gs->players[i].x,   ny = gs->players[i].y;
+        if (ox == nx && oy == ny) continue;
+        if (ox < ly->vis_w && oy < ly->vis_h) draw_cell(ly, gs, ox, oy); // deja de ser cabeza
+        if (nx < ly->vis_w && ny < ly->vis_h) draw_cell(ly, gs, nx, ny);
     }
 }
 
@@ -207,30 +240,68 @@ int main(int argc, char **argv){
     sync_t *sync = attach_sync_shm();
     if (!sync){ perror("attach sync"); return 1; }
 
+    // Copia privada reutilizable: se dibuja sin lock, el master nunca espera al terminal
+    // prev: último frame dibujado, para redibujar solo lo que cambió
+    size_t frame_size = game_state_size(gs->width, gs->height, board_layout(gs));
+    game_state_t *frame = malloc(frame_size);
+    game_state_t *prev  = malloc(frame_size);
+    chtype *line = malloc(((size_t)gs->width * 6 + 1) * sizeof(chtype)); // xmul <= 6
+    if (!frame || !prev || !line){ perror("malloc frame"); return 1; }
+
     ui_init();
     init_colors();
 
-    layout_t ly;
+    layout_t ly, drawn_ly;
+    bool have_prev = false;
 
     bool finished;
+    bool async = sync->view_async;
+    unsigned int seen = 0;
+    long long next_frame = monotonic_ms();
 
     do {
-        sem_wait(&sync->drawing_signal);
-        reader_lock(sync);
-
-        finished = gs->finished;
-        compute_layout(&ly, gs);
-        clear();
-
-        draw_header(gs);
-        draw_players_info(gs);
-        draw_board_frame(&ly);
-        draw_board(&ly, gs);
+        if (async) {
+            // Sin handshake: dibujamos el último estado publicado, a lo sumo uno por período
+            seen = wait_view_frame(sync, seen);
+        } else {
+            sem_wait(&sync->drawing_signal);
+        }
+        snapshot_game_state(frame, gs, sync);
+
+        finished = frame->finished;
+        compute_layout(&ly, frame);
+
+        // clear() + tablero completo solo si cambió la geometría (primer frame, resize)
+        bool full = !have_prev || memcmp(&ly, &drawn_ly, sizeof(ly)) != 0;
+        if (full) clear();
+
+        draw_header(frame);
+        draw_players_info(frame);
+        if (full) {
+            draw_board_frame(&ly);
+            draw_board(&ly, frame, line);
+        } else {
+            draw_board_dirty(&ly, frame, prev);
+        }
 
-        reader_unlock(sync);
         refresh();
-        sem_post(&sync->not_drawing_signal);
 
+        game_state_t *tmp = prev; prev = frame; frame = tmp;
+        drawn_ly = ly;
+        have_prev = true;
+
+        if (!async) {
+            sem_post(&sync->not_drawing_signal);
+        } else if (!finished) {
+            next_frame += sync->view_frame_ms;
+            long long now = monotonic_ms();
+            if (next_frame > now) {
+                struct timespec ts = { .tv_sec = (next_frame - now) / 1000, .tv_nsec = ((next_frame - now) % 1000) * 1000000L };
+                nanosleep(&ts, NULL);
+            } else {
+                next_frame = now; // behind schedule: no catch-up burst
+            }
+        }
     } while (!finished);
 
 
@@ -243,5 +314,8 @@ int main(int argc, char **argv){
     getch();
 
     ui_end();
+    free(frame);
+    free(prev);
+    free(line);
     return 0;
 }